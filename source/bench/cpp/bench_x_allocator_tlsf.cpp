@@ -0,0 +1,90 @@
+#include "xbase/x_base.h"
+#include "xbase/x_allocator.h"
+#include "xbase/x_printf.h"
+#include "xbase/x_runes.h"
+#include "xallocator/x_allocator_tlsf.h"
+
+#include <chrono>
+
+using namespace xcore;
+
+// -------------------------------------------------------------------------------------------------
+// TLSF fit policies, throughput against fragmentation. Not part of the unit tests, the numbers only
+// mean something in a release build on a quiet machine.
+// -------------------------------------------------------------------------------------------------
+namespace
+{
+    // Random alloc/free churn on a heap, the sizes are mostly small with a tail of larger blocks. Returns
+    // the number of operations per millisecond, @outPeak is the peak of the requested bytes that were live.
+    u32 tlsf_churn(tlsf_heap_t* heap, u32 num_ops, u64& outPeak)
+    {
+        const s32 num_slots = 4096;
+        void*     mem[num_slots];
+        u32       size[num_slots];
+        for (s32 i = 0; i < num_slots; ++i)
+            mem[i] = NULL;
+
+        u64 live = 0;
+        outPeak  = 0;
+        u32 seed = 0x13579bd;
+
+        std::chrono::steady_clock::time_point const start = std::chrono::steady_clock::now();
+        for (u32 n = 0; n < num_ops; ++n)
+        {
+            seed        = seed * 1664525 + 1013904223;
+            s32 const i = (s32)((seed >> 8) % num_slots);
+            if (mem[i] != NULL)
+            {
+                heap->deallocate(mem[i]);
+                live -= size[i];
+                mem[i] = NULL;
+                continue;
+            }
+
+            seed            = seed * 1664525 + 1013904223;
+            u32 const r     = (seed >> 8) % 100;
+            u32 const range = r < 70 ? 256 : (r < 95 ? 4096 : 32768);
+            size[i]         = 16 + (seed >> 12) % range;
+            mem[i]          = heap->allocate(size[i], 8);
+            live += size[i];
+            outPeak = live > outPeak ? live : outPeak;
+        }
+        std::chrono::steady_clock::time_point const end = std::chrono::steady_clock::now();
+
+        for (s32 i = 0; i < num_slots; ++i)
+            heap->deallocate(mem[i]);
+
+        u64 const us = (u64)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        return (u32)(((u64)num_ops * 1000) / (us == 0 ? 1 : us));
+    }
+} // namespace
+
+int main()
+{
+    xbase::x_Init();
+
+    alloc_t* allocator = alloc_t::get_system();
+
+    // The memory that the heap reserved for the peak of live bytes
+    ETlsfFit const fits[]  = {TLSF_FIT_GOOD, TLSF_FIT_BEST, TLSF_FIT_ADDRESS};
+    const char*    names[] = {"good-fit", "best-fit", "address-ordered"};
+    for (s32 f = 0; f < 3; ++f)
+    {
+        tlsf_heap_t* heap = gCreateTlsfHeap(allocator, 256 * 1024, fits[f]);
+
+        u64       peak       = 0;
+        u32 const ops_per_ms = tlsf_churn(heap, 2000000, peak);
+
+        tlsf_heap_t::stats_t stats;
+        heap->get_stats(stats);
+
+        u32 const overhead = (u32)((stats.mReserved * 100) / peak) - 100;
+        crunes_t  format("tlsf %s: %u ops/ms, %u KB reserved for a peak of %u KB live (+%u%%)\n");
+        printf(format, va_t(names[f]), va_t(ops_per_ms), va_t((u32)(stats.mReserved / 1024)), va_t((u32)(peak / 1024)), va_t(overhead));
+
+        heap->release();
+    }
+
+    xbase::x_Exit();
+    return 0;
+}
@@ -1,10 +1,501 @@
 #include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
 
 #include "xallocator/x_allocator.h"
+#include "xallocator/x_allocator_buddy.h"
+#include "xallocator/x_allocator_ext.h"
+#include "xallocator/x_allocator_giant.h"
+#include "xallocator/x_allocator_medium.h"
 #include "xallocator/x_allocator_tlsf.h"
+#include "xallocator/x_occupancy.h"
+#include "xallocator/x_page_provider.h"
 
 namespace xcore
 {
-    alloc_t* gCreateHeapAllocator(void* mem_begin, u32 mem_size) { return gCreateTlsfAllocator(mem_begin, mem_size); }
+    namespace xheap
+    {
+        enum
+        {
+            CHUNK_SHIFT       = 16, // Granularity of the page map, also the size of a slab
+            CHUNK_SIZE        = 1 << CHUNK_SHIFT,
+            SMALL_MAX_SIZE    = 2048,
+            MEDIUM_MAX_SIZE   = 256 * 1024,
+            MEDIUM_MAX_ALIGN  = 4096,
+            LARGE_MAX_BLOCK   = 32 * 1024 * 1024,
+            NUM_SMALL_CLASSES = 28,
+            HEAP_MIN_SIZE     = 512 * 1024, // A smaller block is one TLSF allocator
+        };
+
+        enum EKind
+        {
+            KIND_NONE   = 0,
+            KIND_SMALL  = 1,
+            KIND_MEDIUM = 2,
+            KIND_LARGE  = 3,
+        };
+
+        // Small size classes, and the class for every size in steps of 8 bytes: sSmallClass[(size + 7) >> 3]
+        static const u32 sSmallSize[NUM_SMALL_CLASSES] = {
+            8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384, 448, 512, 640, 768, 896, 1024, 1280, 1536, 1792, 2048,
+        };
+
+        static const u8 sSmallClass[(SMALL_MAX_SIZE >> 3) + 1] = {
+            0, 0, 1, 2, 3, 4, 5, 6, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 12, 12, 13, 13, 13, 13, 14, 14, 14, 14, 15, 15, 15,
+            15, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17, 17, 18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19,
+            19, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21, 21,
+            21, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23, 23,
+            23, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24,
+            24, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25, 25,
+            25, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+            26, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27, 27,
+            27,
+        };
+
+        // Hands out the memory of the heap block from front to back, deallocate does nothing. Used for the
+        // heap itself and to create the back-ends, every chunk that it touches is marked in the page map.
+        class carve_t : public alloc_t
+        {
+        public:
+            carve_t(xbyte* begin, xbyte* end)
+                : mCursor(begin)
+                , mEnd(end)
+                , mPageMap(NULL)
+                , mBase(NULL)
+                , mKind(KIND_NONE)
+            {
+            }
+
+            inline u64 remaining() const { return (u64)(mEnd - mCursor); }
+
+            xbyte* mCursor;
+            xbyte* mEnd;
+            u8*    mPageMap;
+            xbyte* mBase;
+            EKind  mKind;
+
+        protected:
+            virtual void* v_allocate(u32 size, u32 alignment)
+            {
+                xbyte* ptr = (xbyte*)xalignUp((uptr)mCursor, (uptr)(alignment == 0 ? 1 : alignment));
+                if (ptr > mEnd || (uptr)size > (uptr)(mEnd - ptr))
+                    return NULL;
+                mCursor = ptr + size;
+                if (mPageMap != NULL && size > 0)
+                {
+                    uptr const first = (uptr)(ptr - mBase) >> CHUNK_SHIFT;
+                    uptr const last  = (uptr)(ptr + size - 1 - mBase) >> CHUNK_SHIFT;
+                    for (uptr c = first; c <= last; ++c)
+                        mPageMap[c] = (u8)mKind;
+                }
+                return ptr;
+            }
+            virtual u32  v_deallocate(void*) { return 0; }
+            virtual void v_release() {}
+        };
+
+        // A slab is one chunk from the large (buddy) allocator, the header is at the end so that the slots
+        // start at the chunk boundary and are aligned on (the largest power of 2 in) their size.
+        struct slab_t
+        {
+            slab_t* mPrev;
+            slab_t* mNext;
+            void*   mFreeList;
+            u32     mClass;
+            u32     mNumUsed;
+            u32     mNumSlots;
+            u32     mNumBumped; // Slots that have been handed out at least once, the rest is untouched
+        };
+
+        static inline slab_t* slab_of(void* ptr) { return (slab_t*)(((uptr)ptr & ~((uptr)CHUNK_SIZE - 1)) + CHUNK_SIZE - sizeof(slab_t)); }
+
+        // The tier that is tried first for a size, small then medium then large (and giant)
+        static inline bool is_small(u32 size, u32 alignment) { return size <= SMALL_MAX_SIZE && alignment <= SMALL_MAX_SIZE; }
+        static inline bool is_medium(u32 size, u32 alignment) { return size <= MEDIUM_MAX_SIZE && alignment <= MEDIUM_MAX_ALIGN; }
+
+        // The slots of a class are aligned on the largest power of 2 that divides the class size
+        static inline u32 small_class(u32 size, u32 alignment)
+        {
+            u32 const aligned = xalignUp(size == 0 ? 1 : size, alignment);
+            u32       c       = sSmallClass[(aligned + 7) >> 3];
+            while ((sSmallSize[c] & (alignment - 1)) != 0)
+                ++c;
+            return c;
+        }
+    } // namespace xheap
+
+    // Tiered heap
+    //
+    //     small   (<= 2 KB)      slabs with a free list per size class, a slab is a 64 KB buddy block
+    //     medium  (<= 256 KB)    page runs per size class (x_allocator_medium)
+    //     large   (<= 32 MB)     buddy allocator, naturally aligned power of 2 blocks
+    //     giant                  mapped directly from the OS (x_allocator_giant)
+    //
+    // The memory block holds the heap, the page map and the arenas of the medium and large back-ends. The
+    // page map has a byte per 64 KB chunk (aligned, so a slab is exactly one chunk) that tells which back-end
+    // owns it, deallocate() looks it up. A pointer outside of the block belongs to the giant allocator.
+    //
+    // The back-ends are created in order; heap, page map, medium arena, medium bookkeeping, large arena,
+    // large bookkeeping. An arena only shares a chunk with bookkeeping of its own back-end or with the heap.
+    // The medium tier is left out when its part of the block can't hold a run of the largest medium size,
+    // the medium sizes then go to the large tier.
+    class x_allocator_heap : public alloc_ext_t
+    {
+    public:
+        x_allocator_heap(xbyte* cursor, xbyte* base, xbyte* end, u8* page_map);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Heap]"; }
+
+        bool init();
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_release();
+        virtual void* v_allocate_at_least(u32 size, u32 alignment, u32& outSize);
+        virtual u32   v_deallocate_sized(void* ptr, u32 size, u32 alignment);
+        virtual u32   v_usable_size(void* ptr) const;
+        virtual void* v_reallocate(void* ptr, u32 size, u32 alignment);
+
+        void* alloc_tiered(u32 size, u32 alignment);
+        void* alloc_small(u32 c);
+        u32   free_small(void* ptr);
+        void* alloc_large(u32 size, u32 alignment, xheap::EKind kind);
+
+        inline xheap::EKind kind_of(void* ptr) const
+        {
+            if ((xbyte*)ptr < mBase || (xbyte*)ptr >= mEnd)
+                return xheap::KIND_NONE;
+            return (xheap::EKind)mPageMap[((xbyte*)ptr - mBase) >> xheap::CHUNK_SHIFT];
+        }
+
+    private:
+        xheap::carve_t   mCarve; // The parent of the medium and large back-ends
+        xbyte*           mBase;
+        xbyte*           mEnd;
+        u8*              mPageMap;
+        alloc_ext_t*     mMedium;
+        alloc_ext_t*     mLarge;
+        giant_alloc_t*   mGiant;
+        page_provider_t* mGiantPages;
+        alloc_t*         mGiantRegistry; // Page allocator for the registry of the giant allocator
+        xheap::slab_t*   mSlabs[xheap::NUM_SMALL_CLASSES]; // Slabs with at least one free slot
+        bool             mSmallSpilled;                    // A small size was served by another tier
+
+        x_allocator_heap(const x_allocator_heap&);
+        x_allocator_heap& operator=(const x_allocator_heap&);
+    };
+
+    x_allocator_heap::x_allocator_heap(xbyte* cursor, xbyte* base, xbyte* end, u8* page_map)
+        : mCarve(cursor, end)
+        , mBase(base)
+        , mEnd(end)
+        , mPageMap(page_map)
+        , mMedium(NULL)
+        , mLarge(NULL)
+        , mGiant(NULL)
+        , mGiantPages(NULL)
+        , mGiantRegistry(NULL)
+        , mSmallSpilled(false)
+    {
+        for (u32 c = 0; c < xheap::NUM_SMALL_CLASSES; ++c)
+            mSlabs[c] = NULL;
+        mCarve.mPageMap = page_map;
+        mCarve.mBase    = base;
+    }
+
+    bool x_allocator_heap::init()
+    {
+        xheap::carve_t& carve = mCarve;
+
+        // A quarter of the memory for the medium sizes, the rest for the large (and small) sizes. The buddy
+        // arena is placed first, it is aligned on the largest block and keeps some room for its bookkeeping.
+        u64 const    total      = carve.remaining();
+        xbyte* const medium     = carve.mCursor + (total / 4 > xheap::MEDIUM_MAX_SIZE ? total / 4 : 0);
+        u32          max_block  = xheap::LARGE_MAX_BLOCK;
+        u32          num_blocks = 0;
+        xbyte*       arena      = NULL;
+        while (max_block >= xheap::CHUNK_SIZE)
+        {
+            arena           = (xbyte*)xalignUp((uptr)medium, (uptr)max_block);
+            u64 const slack = xheap::CHUNK_SIZE + (total >> (xheap::CHUNK_SHIFT - 2));
+            if (arena < carve.mEnd && (u64)(carve.mEnd - arena) > slack)
+                num_blocks = (u32)(((u64)(carve.mEnd - arena) - slack) / max_block);
+            if (num_blocks >= 2 || (num_blocks == 1 && max_block == xheap::CHUNK_SIZE))
+                break;
+            max_block >>= 1;
+            num_blocks = 0;
+        }
+        if (num_blocks == 0)
+            return false;
+
+        // The medium tier gets everything in front of the buddy arena, the alignment gap included. Its
+        // bookkeeping is less than 64 bytes per page plus the object, and the arena is page aligned.
+        u64 const room = (u64)(arena - carve.mCursor);
+        if (room > 2 * xheap::MEDIUM_MAX_ALIGN)
+        {
+            u64 const pages = (room - 2 * xheap::MEDIUM_MAX_ALIGN) / (xheap::MEDIUM_MAX_ALIGN + 64);
+            if (pages * xheap::MEDIUM_MAX_ALIGN >= xheap::MEDIUM_MAX_SIZE)
+            {
+                carve.mKind = xheap::KIND_MEDIUM;
+                mMedium     = gCreateMediumAllocator(&carve, (u32)(pages * xheap::MEDIUM_MAX_ALIGN));
+            }
+        }
+
+        carve.mKind = xheap::KIND_LARGE;
+        mLarge      = gCreateBuddyAllocator(&carve, xheap::CHUNK_SIZE, max_block, num_blocks);
+        if (mLarge == NULL)
+            return false;
+
+        // The giant allocator is the fallback of a full heap, so its registry is kept in pages of its own.
+        // There is no giant allocator when the platform can't map directly.
+        carve.mPageMap = NULL;
+        mGiantPages    = gCreateVirtualPageProvider(&carve, PAGES_DEFAULT);
+        if (mGiantPages != NULL)
+        {
+            mGiantRegistry = gCreatePageAllocator(&carve, mGiantPages);
+            mGiant         = gCreateGiantAllocator(mGiantRegistry);
+        }
+        return true;
+    }
+
+    void* x_allocator_heap::v_allocate(u32 size, u32 alignment)
+    {
+        alignment = alignment == 0 ? 1 : alignment;
+
+        if (xheap::is_small(size, alignment))
+        {
+            void* ptr = alloc_small(xheap::small_class(size, alignment));
+            if (ptr != NULL)
+                return ptr;
+            mSmallSpilled = true;
+        }
+        return alloc_tiered(size, alignment);
+    }
+
+    // A small size knows its usable size without a lookup, the other tiers ask the block
+    void* x_allocator_heap::v_allocate_at_least(u32 size, u32 alignment, u32& outSize)
+    {
+        alignment = alignment == 0 ? 1 : alignment;
+
+        if (xheap::is_small(size, alignment))
+        {
+            u32 const c   = xheap::small_class(size, alignment);
+            void*     ptr = alloc_small(c);
+            if (ptr != NULL)
+            {
+                outSize = xheap::sSmallSize[c];
+                return ptr;
+            }
+            mSmallSpilled = true;
+        }
+
+        void* ptr = alloc_tiered(size, alignment);
+        outSize   = ptr != NULL ? v_usable_size(ptr) : 0;
+        return ptr;
+    }
+
+    // Everything that is not in a slab; medium, large and giant
+    void* x_allocator_heap::alloc_tiered(u32 size, u32 alignment)
+    {
+        if (mMedium != NULL && xheap::is_medium(size, alignment))
+        {
+            void* ptr = mMedium->allocate(size, alignment);
+            if (ptr != NULL)
+                return ptr;
+        }
+
+        void* ptr = alloc_large(size, alignment, xheap::KIND_LARGE);
+        if (ptr != NULL)
+            return ptr;
+
+        if (mGiant != NULL)
+            return mGiant->allocate(size, alignment);
+        return NULL;
+    }
+
+    u32 x_allocator_heap::v_deallocate(void* ptr)
+    {
+        if (ptr == NULL)
+            return 0;
+
+        switch (kind_of(ptr))
+        {
+            case xheap::KIND_SMALL: return free_small(ptr);
+            case xheap::KIND_MEDIUM: return mMedium->deallocate(ptr);
+            case xheap::KIND_LARGE: return mLarge->deallocate(ptr);
+            default: break;
+        }
+
+        ASSERT(mGiant != NULL && mGiant->owns(ptr));
+        return mGiant->deallocate(ptr);
+    }
+
+    // A small size is in a slab, as long as no small size has ever been spilled to another tier. A size
+    // that is neither small nor medium (or any size that is not small when there is no medium tier) is in
+    // the large tier when it is in the block. Both skip the page map, anything else takes the normal path.
+    u32 x_allocator_heap::v_deallocate_sized(void* ptr, u32 size, u32 alignment)
+    {
+        if (ptr == NULL)
+            return 0;
+
+        alignment = alignment == 0 ? 1 : alignment;
+        if ((xbyte*)ptr >= mBase && (xbyte*)ptr < mEnd)
+        {
+            if (xheap::is_small(size, alignment) && !mSmallSpilled)
+            {
+                ASSERT(kind_of(ptr) == xheap::KIND_SMALL);
+                ASSERT(xheap::slab_of(ptr)->mClass == xheap::small_class(size, alignment));
+                return free_small(ptr);
+            }
+            if (!xheap::is_small(size, alignment) && (mMedium == NULL || !xheap::is_medium(size, alignment)))
+            {
+                ASSERT(kind_of(ptr) == xheap::KIND_LARGE);
+                return mLarge->deallocate(ptr, size, alignment);
+            }
+        }
+        return v_deallocate(ptr);
+    }
+
+    u32 x_allocator_heap::v_usable_size(void* ptr) const
+    {
+        switch (kind_of(ptr))
+        {
+            case xheap::KIND_SMALL: return xheap::sSmallSize[xheap::slab_of(ptr)->mClass];
+            case xheap::KIND_MEDIUM: return mMedium->usable_size(ptr);
+            case xheap::KIND_LARGE: return mLarge->usable_size(ptr);
+            default: break;
+        }
+
+        ASSERT(mGiant != NULL && mGiant->owns(ptr));
+        return mGiant->usable_size(ptr);
+    }
+
+    // A giant block is remapped, its pages are never copied. Any other block moves.
+    void* x_allocator_heap::v_reallocate(void* ptr, u32 size, u32 alignment)
+    {
+        if (ptr != NULL && kind_of(ptr) == xheap::KIND_NONE)
+        {
+            ASSERT(mGiant != NULL && mGiant->owns(ptr));
+            return mGiant->reallocate(ptr, (u64)size);
+        }
+        return alloc_ext_t::v_reallocate(ptr, size, alignment);
+    }
+
+    void* x_allocator_heap::alloc_large(u32 size, u32 alignment, xheap::EKind kind)
+    {
+        xbyte* ptr = (xbyte*)mLarge->allocate(size, alignment);
+        if (ptr != NULL)
+            mPageMap[(ptr - mBase) >> xheap::CHUNK_SHIFT] = (u8)kind;
+        return ptr;
+    }
+
+    void* x_allocator_heap::alloc_small(u32 c)
+    {
+        xheap::slab_t* slab = mSlabs[c];
+        if (slab == NULL)
+        {
+            xbyte* chunk = (xbyte*)alloc_large(xheap::CHUNK_SIZE, xheap::CHUNK_SIZE, xheap::KIND_SMALL);
+            if (chunk == NULL)
+                return NULL;
+            slab             = xheap::slab_of(chunk);
+            slab->mPrev      = NULL;
+            slab->mNext      = NULL;
+            slab->mFreeList  = NULL;
+            slab->mClass     = c;
+            slab->mNumUsed   = 0;
+            slab->mNumSlots  = (u32)(xheap::CHUNK_SIZE - sizeof(xheap::slab_t)) / xheap::sSmallSize[c];
+            slab->mNumBumped = 0;
+            mSlabs[c]        = slab;
+        }
+
+        void* ptr = slab->mFreeList;
+        if (ptr != NULL)
+            slab->mFreeList = *(void**)ptr;
+        else
+            ptr = ((xbyte*)slab + sizeof(xheap::slab_t) - xheap::CHUNK_SIZE) + (uptr)(slab->mNumBumped++) * xheap::sSmallSize[c];
+
+        // A full slab leaves the list, it comes back when a slot is freed
+        if (++slab->mNumUsed == slab->mNumSlots)
+        {
+            mSlabs[c] = slab->mNext;
+            if (slab->mNext != NULL)
+                slab->mNext->mPrev = NULL;
+            slab->mNext = NULL;
+        }
+        return ptr;
+    }
+
+    u32 x_allocator_heap::free_small(void* ptr)
+    {
+        xheap::slab_t* slab = xheap::slab_of(ptr);
+        u32 const      c    = slab->mClass;
+
+        *(void**)ptr    = slab->mFreeList;
+        slab->mFreeList = ptr;
+
+        if (slab->mNumUsed-- == slab->mNumSlots)
+        {
+            slab->mPrev = NULL;
+            slab->mNext = mSlabs[c];
+            if (mSlabs[c] != NULL)
+                mSlabs[c]->mPrev = slab;
+            mSlabs[c] = slab;
+        }
+
+        // An empty slab goes back, unless it is the only slab of its class with free slots
+        if (slab->mNumUsed == 0 && (mSlabs[c] != slab || slab->mNext != NULL))
+        {
+            if (slab->mPrev != NULL)
+                slab->mPrev->mNext = slab->mNext;
+            else
+                mSlabs[c] = slab->mNext;
+            if (slab->mNext != NULL)
+                slab->mNext->mPrev = slab->mPrev;
+            mLarge->deallocate((xbyte*)slab + sizeof(xheap::slab_t) - xheap::CHUNK_SIZE);
+        }
+        return xheap::sSmallSize[c];
+    }
+
+    void x_allocator_heap::v_release()
+    {
+        if (mGiant != NULL)
+            mGiant->release();
+        if (mGiantRegistry != NULL)
+            mGiantRegistry->release();
+        if (mGiantPages != NULL)
+            mGiantPages->destroy();
+        mLarge->release();
+        if (mMedium != NULL)
+            mMedium->release();
+        this->~x_allocator_heap();
+    }
+
+    alloc_ext_t* gCreateHeapAllocator(void* mem_begin, u32 mem_size)
+    {
+        // The tiers need a few hundred KB, a smaller block is served by TLSF alone
+        if (mem_size < xheap::HEAP_MIN_SIZE)
+            return gCreateTlsfAllocator(mem_begin, mem_size);
+
+        xbyte* const   end  = (xbyte*)mem_begin + mem_size;
+        xbyte* const   base = (xbyte*)((uptr)mem_begin & ~((uptr)xheap::CHUNK_SIZE - 1));
+        u32 const      size = (u32)((end - base) >> xheap::CHUNK_SHIFT) + 1;
+        xheap::carve_t carve((xbyte*)mem_begin, end);
+
+        void* mem      = carve.allocate(sizeof(x_allocator_heap), sizeof(void*));
+        u8*   page_map = (u8*)carve.allocate(size, sizeof(void*));
+        if (mem == NULL || page_map == NULL)
+            return NULL;
+        for (u32 i = 0; i < size; ++i)
+            page_map[i] = xheap::KIND_NONE;
+
+        x_allocator_heap* heap = new (mem) x_allocator_heap(carve.mCursor, base, end, page_map);
+        if (!heap->init())
+            return NULL;
+        return heap;
+    }
 
 }; // namespace xcore
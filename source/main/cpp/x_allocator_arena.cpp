@@ -0,0 +1,170 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_allocator.h"
+
+#include "xallocator/x_allocator_arena.h"
+
+namespace xcore
+{
+    class x_allocator_arena : public arena_t
+    {
+    public:
+        x_allocator_arena(alloc_t* allocator, u32 block_size);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Arena]"; }
+
+        bool initialize();
+
+        virtual void rewind(marker_t const& marker);
+        virtual void reset();
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        // Header at the start of every block
+        struct block_t
+        {
+            block_t* mPrev;
+            u32      mSize;
+        };
+
+        virtual void* v_grow(u32 size, u32 alignment);
+        virtual void  v_release();
+
+        block_t* new_block(u32 size);
+        void     push_block(block_t* block);
+        void     recycle_block(block_t* block);
+
+    private:
+        alloc_t* mAllocator;
+        u32      mBlockSize;
+        block_t* mFirst;
+        block_t* mSpare;
+
+        x_allocator_arena(const x_allocator_arena&);
+        x_allocator_arena& operator=(const x_allocator_arena&);
+    };
+
+    x_allocator_arena::x_allocator_arena(alloc_t* allocator, u32 block_size) : mAllocator(allocator), mBlockSize(block_size), mFirst(NULL), mSpare(NULL) {}
+
+    bool x_allocator_arena::initialize()
+    {
+        ASSERT(mBlockSize > sizeof(block_t));
+        mFirst = new_block(mBlockSize);
+        if (mFirst == NULL)
+            return false;
+        mFirst->mPrev = NULL;
+        push_block(mFirst);
+        return true;
+    }
+
+    x_allocator_arena::block_t* x_allocator_arena::new_block(u32 size)
+    {
+        if (size < mBlockSize)
+            size = mBlockSize;
+        block_t* block = (block_t*)mAllocator->allocate(size, sizeof(void*));
+        if (block != NULL)
+            block->mSize = size;
+        return block;
+    }
+
+    void x_allocator_arena::push_block(block_t* block)
+    {
+        if (block != mFirst)
+            block->mPrev = (block_t*)mBlock;
+        mBlock  = block;
+        mCursor = (xbyte*)(block + 1);
+        mEnd    = (xbyte*)block + block->mSize;
+    }
+
+    // Keep the largest released block as the spare, give the other one back to the parent
+    void x_allocator_arena::recycle_block(block_t* block)
+    {
+        if (mSpare == NULL)
+        {
+            mSpare = block;
+        }
+        else if (block->mSize > mSpare->mSize)
+        {
+            mAllocator->deallocate(mSpare);
+            mSpare = block;
+        }
+        else
+        {
+            mAllocator->deallocate(block);
+        }
+    }
+
+    void* x_allocator_arena::v_grow(u32 size, u32 alignment)
+    {
+        // Worst case the block data needs (alignment - 1) bytes of padding. Computed in 64 bits, close to
+        // 4 GB it wraps around and the block would be too small, alloc() would then grow again and again.
+        u64 const needed = (u64)sizeof(block_t) + size + (alignment - 1);
+        if (needed > 0xffffffff)
+            return NULL;
+
+        block_t* block;
+        if (mSpare != NULL && mSpare->mSize >= needed)
+        {
+            block  = mSpare;
+            mSpare = NULL;
+        }
+        else
+        {
+            block = new_block((u32)needed);
+            if (block == NULL)
+                return NULL;
+        }
+
+        push_block(block);
+        return alloc(size, alignment);
+    }
+
+    void x_allocator_arena::rewind(marker_t const& marker)
+    {
+        while (mBlock != marker.mBlock)
+        {
+            // The marker has to be from this arena and not rewound past already
+            ASSERT(mBlock != mFirst);
+            block_t* block = (block_t*)mBlock;
+            mBlock         = block->mPrev;
+            recycle_block(block);
+        }
+
+        block_t* block = (block_t*)mBlock;
+        ASSERT(marker.mCursor >= (xbyte*)(block + 1) && marker.mCursor <= (xbyte*)block + block->mSize);
+        mCursor = marker.mCursor;
+        mEnd    = (xbyte*)block + block->mSize;
+    }
+
+    void x_allocator_arena::reset()
+    {
+        marker_t marker = {mFirst, (xbyte*)(mFirst + 1)};
+        rewind(marker);
+    }
+
+    void x_allocator_arena::v_release()
+    {
+        reset();
+        if (mSpare != NULL)
+            mAllocator->deallocate(mSpare);
+        mAllocator->deallocate(mFirst);
+
+        alloc_t* allocator = mAllocator;
+        this->~x_allocator_arena();
+        allocator->deallocate(this);
+    }
+
+    arena_t* gCreateArenaAllocator(alloc_t* allocator, u32 block_size)
+    {
+        void*              mem   = allocator->allocate(sizeof(x_allocator_arena), sizeof(void*));
+        x_allocator_arena* arena = new (mem) x_allocator_arena(allocator, block_size);
+        if (!arena->initialize())
+        {
+            arena->~x_allocator_arena();
+            allocator->deallocate(mem);
+            return NULL;
+        }
+        return arena;
+    }
+}; // namespace xcore
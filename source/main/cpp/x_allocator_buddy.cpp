@@ -0,0 +1,233 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+
+#include "xallocator/x_allocator_buddy.h"
+#include "xallocator/x_allocator_ext.h"
+#include "xallocator/x_occupancy.h"
+#include "xallocator/private/x_hibitset.h"
+
+namespace xcore
+{
+    // Binary buddy allocator
+    //
+    // Order 0 is the smallest block, at order k a block is (min_block_size << k) bytes and the memory
+    // holds (num_max_blocks << (max_order - k)) blocks. Every order has a hierarchical bitmap with a
+    // bit per block that is set when the block is free. mFreeOrders has a bit per order that is set
+    // when that order has at least one free block.
+    //
+    // For every smallest block there is a byte that holds the order of the allocation that starts
+    // there, or NOT_ALLOCATED, this is the only per-allocation state.
+    class x_allocator_buddy : public alloc_ext_t
+    {
+    public:
+        enum
+        {
+            MAX_ORDERS    = 32,
+            NOT_ALLOCATED = 0xff,
+        };
+
+        x_allocator_buddy(alloc_t* allocator, xbyte* memory, u32 min_shift, u32 max_order, u32 num_max_blocks, xbyte* orders, u64* words);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Buddy]"; }
+
+        static u32 words_for(u32 max_order, u32 num_max_blocks);
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_release();
+        virtual u32   v_deallocate_sized(void* ptr, u32 size, u32 alignment);
+        virtual u32   v_usable_size(void* ptr) const;
+
+        inline u32 num_blocks(u32 order) const { return mNumMaxBlocks << (mMaxOrder - order); }
+
+        // The block size is the larger of size and alignment, rounded up to a power of 2
+        inline u32 order_of(u32 size, u32 alignment) const
+        {
+            u32 const request = size > alignment ? size : alignment;
+            if (request <= ((u32)1 << mMinShift))
+                return 0;
+            return (u32)xoccupancy_t::find_last_bit((u64)request - 1) + 1 - mMinShift;
+        }
+
+        u32 free_block(u32 first, u32 order);
+
+        inline void set_free(u32 order, u32 index)
+        {
+            mFree[order].set(index);
+            mFreeOrders |= (1u << order);
+        }
+
+        inline void clr_free(u32 order, u32 index)
+        {
+            mFree[order].clr(index);
+            if (mFree[order].mLevel[0][0] == 0)
+                mFreeOrders &= ~(1u << order);
+        }
+
+    private:
+        alloc_t*    mAllocator;
+        xbyte*      mMemory;
+        u32         mMinShift;
+        u32         mMaxOrder;
+        u32         mNumMaxBlocks;
+        u32         mFreeOrders;
+        xbyte*      mOrders;
+        xhibitset_t mFree[MAX_ORDERS];
+
+        x_allocator_buddy(const x_allocator_buddy&);
+        x_allocator_buddy& operator=(const x_allocator_buddy&);
+    };
+
+    u32 x_allocator_buddy::words_for(u32 max_order, u32 num_max_blocks)
+    {
+        u32 words = 0;
+        for (u32 order = 0; order <= max_order; ++order)
+            words += xhibitset_t::words_for(num_max_blocks << (max_order - order));
+        return words;
+    }
+
+    x_allocator_buddy::x_allocator_buddy(alloc_t* allocator, xbyte* memory, u32 min_shift, u32 max_order, u32 num_max_blocks, xbyte* orders, u64* words)
+        : mAllocator(allocator)
+        , mMemory(memory)
+        , mMinShift(min_shift)
+        , mMaxOrder(max_order)
+        , mNumMaxBlocks(num_max_blocks)
+        , mFreeOrders(0)
+        , mOrders(orders)
+    {
+        for (u32 order = 0; order <= max_order; ++order)
+        {
+            u32 const n = num_blocks(order);
+            mFree[order].init(words, n, order == max_order);
+            words += xhibitset_t::words_for(n);
+        }
+        mFreeOrders = 1u << max_order;
+
+        u32 const n = num_blocks(0);
+        for (u32 i = 0; i < n; ++i)
+            mOrders[i] = NOT_ALLOCATED;
+    }
+
+    void* x_allocator_buddy::v_allocate(u32 size, u32 alignment)
+    {
+        u32 const order = order_of(size, alignment);
+        if (order > mMaxOrder)
+            return NULL;
+
+        // Smallest order with a free block that is large enough
+        u32 const candidates = mFreeOrders & ~((1u << order) - 1);
+        if (candidates == 0)
+            return NULL;
+        u32 k     = (u32)xoccupancy_t::find_first_bit(candidates);
+        u32 index = (u32)mFree[k].find();
+        clr_free(k, index);
+
+        // Split, the upper half (buddy) becomes free at every step down
+        while (k > order)
+        {
+            --k;
+            index <<= 1;
+            set_free(k, index ^ 1);
+        }
+
+        u32 const first = index << order;
+        mOrders[first]  = (xbyte)order;
+        return mMemory + ((uptr)first << mMinShift);
+    }
+
+    u32 x_allocator_buddy::v_deallocate(void* ptr)
+    {
+        if (ptr == NULL)
+            return 0;
+
+        ASSERT((xbyte*)ptr >= mMemory && (xbyte*)ptr < (mMemory + ((uptr)num_blocks(0) << mMinShift)));
+        u32 const first = (u32)(((xbyte*)ptr - mMemory) >> mMinShift);
+        u32 const order = mOrders[first];
+        ASSERT(order != NOT_ALLOCATED);
+        mOrders[first] = NOT_ALLOCATED;
+        return free_block(first, order);
+    }
+
+    // The order follows from the size, the order byte of the block is not touched. It is only reset in a
+    // debug build, where it is used to verify the size; a stale order is overwritten by the next allocation.
+    u32 x_allocator_buddy::v_deallocate_sized(void* ptr, u32 size, u32 alignment)
+    {
+        if (ptr == NULL)
+            return 0;
+
+        ASSERT((xbyte*)ptr >= mMemory && (xbyte*)ptr < (mMemory + ((uptr)num_blocks(0) << mMinShift)));
+        u32 const first = (u32)(((xbyte*)ptr - mMemory) >> mMinShift);
+        u32 const order = order_of(size, alignment);
+#ifdef TARGET_DEBUG
+        ASSERT(mOrders[first] == order);
+        mOrders[first] = NOT_ALLOCATED;
+#endif
+        return free_block(first, order);
+    }
+
+    u32 x_allocator_buddy::free_block(u32 first, u32 order)
+    {
+        // Merge with the buddy for as long as it is free
+        u32 k     = order;
+        u32 index = first >> order;
+        while (k < mMaxOrder && mFree[k].is_set(index ^ 1))
+        {
+            clr_free(k, index ^ 1);
+            index >>= 1;
+            ++k;
+        }
+        set_free(k, index);
+
+        return (u32)1 << (mMinShift + order);
+    }
+
+    u32 x_allocator_buddy::v_usable_size(void* ptr) const
+    {
+        u32 const first = (u32)(((xbyte*)ptr - mMemory) >> mMinShift);
+        ASSERT(mOrders[first] != NOT_ALLOCATED);
+        return (u32)1 << (mMinShift + mOrders[first]);
+    }
+
+    void x_allocator_buddy::v_release()
+    {
+        alloc_t* allocator = mAllocator;
+        allocator->deallocate(mMemory);
+        this->~x_allocator_buddy();
+        allocator->deallocate(this);
+    }
+
+    alloc_ext_t* gCreateBuddyAllocator(alloc_t* allocator, u32 min_block_size, u32 max_block_size, u32 num_max_blocks)
+    {
+        ASSERT(min_block_size != 0 && (min_block_size & (min_block_size - 1)) == 0);
+        ASSERT(max_block_size >= min_block_size && (max_block_size & (max_block_size - 1)) == 0);
+
+        u32 const min_shift = (u32)xoccupancy_t::find_first_bit(min_block_size);
+        u32 const max_order = (u32)xoccupancy_t::find_first_bit(max_block_size) - min_shift;
+        ASSERT(max_order < x_allocator_buddy::MAX_ORDERS);
+        ASSERT(((u64)max_block_size * num_max_blocks) <= (u64)0xffffffff);
+
+        // The object, the bitmaps and the order per smallest block in one allocation
+        u32 const num_min_blocks = num_max_blocks << max_order;
+        u32 const object_size    = xalignUp((u32)sizeof(x_allocator_buddy), (u32)sizeof(u64));
+        u32 const words_size     = x_allocator_buddy::words_for(max_order, num_max_blocks) * sizeof(u64);
+
+        xbyte* memory = (xbyte*)allocator->allocate(max_block_size * num_max_blocks, max_block_size);
+        if (memory == NULL)
+            return NULL;
+        xbyte* mem = (xbyte*)allocator->allocate(object_size + words_size + num_min_blocks, sizeof(u64));
+        if (mem == NULL)
+        {
+            allocator->deallocate(memory);
+            return NULL;
+        }
+
+        u64*   words  = (u64*)(mem + object_size);
+        xbyte* orders = mem + object_size + words_size;
+        return new (mem) x_allocator_buddy(allocator, memory, min_shift, max_order, num_max_blocks, orders, words);
+    }
+}; // namespace xcore
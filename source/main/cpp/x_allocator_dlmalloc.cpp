@@ -4,6 +4,7 @@
 #include "xbase/x_allocator.h"
 
 #include "xallocator/x_allocator_dlmalloc.h"
+#include "xallocator/x_page_provider.h"
 
 #ifdef TARGET_PS3
 #pragma diag_suppress = no_corresponding_delete
@@ -87,9 +88,6 @@ namespace xcore
         flag_t           default_mflags;
     };
 
-    typedef void* (*SysAllocFunc)(msize_t size);
-    typedef void (*SysFreeFunc)(void* ptrsize);
-
     /**
      * A memory heap capable of managing multiple segments (based on dlmalloc)
      */
@@ -99,8 +97,8 @@ namespace xcore
         malloc_params mParams;
         mstate        mState;
 
-        SysAllocFunc mSysAlloc;
-        SysFreeFunc  mSysFree;
+        page_provider_t* mPages; ///< Source of extra segments, NULL when the heap can't grow
+        msize_t          mSegmentSize;
 
     public:
         void*  __alloc(msize_t bytes);                                                ///< Normal allocation
@@ -111,7 +109,7 @@ namespace xcore
         void** __allocICO(msize_t n_elements, msize_t* element_sizes, void** chunks); ///< Independent continues with different size specified for every element
         u32    __free(void* ptr);
 
-        u32 __usable_size(void* mem);
+        u32 __usable_size(void* mem) const;
 
     protected:
         void*  __internal_realloc(mstate m, void* oldmem, msize_t alignment, msize_t bytes);
@@ -142,6 +140,9 @@ namespace xcore
 
         void __manage(void* mem, msize_t size);
 
+        bool __manage(page_provider_t* pages, msize_t segment_size); ///< Take segments from @pages, the first one right away
+        void __release_segments();                                   ///< Give all segments back to the page provider
+
         static xcore::u32 __sGetMemSize(void* mem);
 
     private:
@@ -1457,9 +1458,9 @@ compilers.
                         unlink_large_chunk(m, tp);
                     }
 
-                    if (mSysFree != NULL)
+                    if (mPages != NULL)
                     {
-                        mSysFree(base);
+                        mPages->release(base, size);
 
                         released += size;
                         m->footprint -= size;
@@ -1490,8 +1491,8 @@ compilers.
 
     void xmem_heap::__initialize()
     {
-        mSysAlloc = NULL;
-        mSysFree  = NULL;
+        mPages       = NULL;
+        mSegmentSize = 0;
 
         x_memset(&mStateData, 0, sizeof(malloc_state));
         mState = &mStateData;
@@ -1505,6 +1506,46 @@ compilers.
         __release_unused_segments(mState);
     }
 
+    bool xmem_heap::__manage(page_provider_t* pages, msize_t segment_size)
+    {
+        segment_size = (segment_size + pages->page_size() - 1) & ~((msize_t)pages->page_size() - 1);
+
+        xbyte* tbase = (xbyte*)pages->reserve(segment_size, pages->page_size());
+        if (tbase == NULL)
+            return false;
+        if (!pages->commit(tbase, segment_size))
+        {
+            pages->release(tbase, segment_size);
+            return false;
+        }
+
+        __manage(tbase, segment_size);
+        mState->seg.sflags = EXTERN_BIT;
+        mPages             = pages;
+        mSegmentSize       = segment_size;
+        return true;
+    }
+
+    void xmem_heap::__release_segments()
+    {
+        if (mPages == NULL)
+            return;
+
+        // Every segment record lives in the segment before it, read it before releasing
+        msegmentptr sp = &mState->seg;
+        while (sp != 0)
+        {
+            xbyte*      base  = sp->base;
+            msize_t     size  = sp->size;
+            flag_t      flags = sp->sflags;
+            msegmentptr next  = sp->next;
+            if ((flags & EXTERN_BIT) != 0)
+                mPages->release(base, size);
+            sp = next;
+        }
+        mPages = NULL;
+    }
+
     /* mstate, give block of memory*/
     void xmem_heap::__manage(void* block, msize_t nb)
     {
@@ -1515,8 +1556,7 @@ compilers.
         xbyte*  tbase = 0;
         msize_t tsize = 0;
         {
-            msegmentptr ss    = (m->top == 0) ? 0 : segment_holding(m, (xbyte*)m->top);
-            msize_t     asize = 0;
+            msize_t asize = 0;
 
             xbyte* base = (xbyte*)block;
             asize       = nb;
@@ -2145,13 +2185,20 @@ compilers.
                 goto postaction;
             }
 
-            if (mSysAlloc != NULL)
+            if (mPages != NULL)
             {
                 // Allocate an extra segment
-                u32 tsize = 8 * 1024 * 1024;
+                msize_t tsize = mSegmentSize;
                 if (nb > tsize)
                     tsize = ((nb / tsize) + 1) * tsize;
-                xbyte* tbase = (xbyte*)mSysAlloc(tsize);
+                xbyte* tbase = (xbyte*)mPages->reserve(tsize, mPages->page_size());
+                if (tbase == NULL)
+                    return NULL;
+                if (!mPages->commit(tbase, tsize))
+                {
+                    mPages->release(tbase, tsize);
+                    return NULL;
+                }
 
                 if ((mState->footprint += tsize) > mState->max_footprint)
                     mState->max_footprint = mState->footprint;
@@ -2392,7 +2439,7 @@ compilers.
         return __internal_ic_alloc(n_elements, sizes, 0, chunks);
     }
 
-    u32 xmem_heap_base::__usable_size(void* mem)
+    u32 xmem_heap_base::__usable_size(void* mem) const
     {
         if (mem != 0)
         {
@@ -2452,17 +2499,26 @@ compilers.
         return chunksize(chunkPtr);
     }
 
-    class x_allocator_dlmalloc : public alloc_t
+    class x_allocator_dlmalloc : public alloc_ext_t
     {
         xmem_heap mDlMallocHeap;
+        alloc_t*  mAllocator; ///< Owner of this object, NULL when it lives in the managed memory
 
     public:
         void init(void* mem, s32 mem_size)
         {
+            mAllocator = NULL;
             mDlMallocHeap.__initialize();
             mDlMallocHeap.__manage(mem, mem_size);
         }
 
+        bool init(alloc_t* allocator, page_provider_t* pages, u32 segment_size)
+        {
+            mAllocator = allocator;
+            mDlMallocHeap.__initialize();
+            return mDlMallocHeap.__manage(pages, segment_size);
+        }
+
         virtual void* v_allocate(u32 size, u32 alignment)
         {
             if (alignment <= X_MEMALIGN)
@@ -2478,15 +2534,27 @@ compilers.
             return 0;
         }
 
-        virtual void v_release() { mDlMallocHeap.__destroy(); }
+        virtual u32 v_usable_size(void* ptr) const { return mDlMallocHeap.__usable_size(ptr); }
+
+        virtual void v_release()
+        {
+            mDlMallocHeap.__destroy();
+            if (mAllocator != NULL)
+            {
+                mDlMallocHeap.__release_segments();
+                alloc_t* allocator = mAllocator;
+                this->~x_allocator_dlmalloc();
+                allocator->deallocate(this);
+            }
+        }
 
-        void* operator new(xsize_t num_bytes) { return NULL; }
-        void* operator new(xsize_t num_bytes, void* mem) { return mem; }
-        void  operator delete(void* pMem) {}
-        void  operator delete(void* pMem, void*) {}
+        void* operator new(xsize_t) { return NULL; }
+        void* operator new(xsize_t, void* mem) { return mem; }
+        void  operator delete(void*) {}
+        void  operator delete(void*, void*) {}
     };
 
-    alloc_t* gCreateDlAllocator(void* mem, u32 memsize)
+    alloc_ext_t* gCreateDlAllocator(void* mem, u32 memsize)
     {
         x_allocator_dlmalloc* allocator = new (mem) x_allocator_dlmalloc();
 
@@ -2497,6 +2565,18 @@ compilers.
         return allocator;
     }
 
+    alloc_ext_t* gCreateDlAllocator(alloc_t* allocator, page_provider_t* pages, u32 segment_size)
+    {
+        void*                 mem    = allocator->allocate(sizeof(x_allocator_dlmalloc), sizeof(void*));
+        x_allocator_dlmalloc* dlheap = new (mem) x_allocator_dlmalloc();
+        if (!dlheap->init(allocator, pages, segment_size))
+        {
+            allocator->deallocate(mem);
+            return NULL;
+        }
+        return dlheap;
+    }
+
 }; // namespace xcore
 
 #ifdef TARGET_PS3
@@ -11,7 +11,7 @@
 namespace xcore
 {
 
-    class x_allocator_forward : public alloc_t
+    class x_allocator_forward : public forward_alloc_t
     {
     public:
         x_allocator_forward();
@@ -25,6 +25,8 @@ namespace xcore
 
         virtual void* v_allocate(u32 size, u32 alignment);
         virtual u32   v_deallocate(void* ptr);
+        virtual void  v_commit(void* ptr, u32 size);
+        virtual u32   v_usable_size(void* ptr) const;
 
         XCORE_CLASS_PLACEMENT_NEW_DELETE
 
@@ -58,11 +60,242 @@ namespace xcore
 
     u32 x_allocator_forward::v_deallocate(void* ptr) { return mForwardAllocator.deallocate(ptr); }
 
-    alloc_t* gCreateForwardAllocator(alloc_t* allocator, u32 memsize)
+    void x_allocator_forward::v_commit(void* ptr, u32 size) { mForwardAllocator.commit(ptr, size); }
+
+    u32 x_allocator_forward::v_usable_size(void* ptr) const { return mForwardAllocator.get_size(ptr); }
+
+    forward_alloc_t* gCreateForwardAllocator(alloc_t* allocator, u32 memsize)
     {
         void*                memForAllocator      = allocator->allocate(sizeof(x_allocator_forward), sizeof(void*));
         void*                mem                  = allocator->allocate(memsize + 32, sizeof(void*));
         x_allocator_forward* forwardRingAllocator = new (memForAllocator) x_allocator_forward((xbyte*)mem, memsize, allocator);
         return forwardRingAllocator;
     }
+
+    class x_allocator_forward_segmented : public forward_alloc_t
+    {
+    public:
+        x_allocator_forward_segmented(alloc_t* allocator, u32 segment_size, u32 max_cached, u32 retire_delay);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Forward, Segmented]"; }
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_commit(void* ptr, u32 size);
+        virtual void  v_release();
+        virtual u32   v_usable_size(void* ptr) const;
+
+        // A segment header is followed by the memory of the segment
+        struct segment_t
+        {
+            segment_t*              mNext;
+            u32                     mEmptySince;
+            xforwardbin::xallocator mForward;
+        };
+
+        segment_t* acquire_segment();
+        segment_t* find_segment(void* ptr) const;
+        void       retire_segments();
+
+    private:
+        alloc_t*   mAllocator;
+        u32        mSegmentSize;
+        u32        mMaxCached;
+        u32        mRetireDelay;
+        u32        mTick;
+        u32        mNumEmpty;
+        u32        mNumCached;
+        segment_t* mCurrent;
+        segment_t* mSegments; // Active segments, including mCurrent
+        segment_t* mCache;
+
+        x_allocator_forward_segmented(const x_allocator_forward_segmented&);
+        x_allocator_forward_segmented& operator=(const x_allocator_forward_segmented&);
+    };
+
+    x_allocator_forward_segmented::x_allocator_forward_segmented(alloc_t* allocator, u32 segment_size, u32 max_cached, u32 retire_delay)
+        : mAllocator(allocator)
+        , mSegmentSize(segment_size)
+        , mMaxCached(max_cached)
+        , mRetireDelay(retire_delay)
+        , mTick(0)
+        , mNumEmpty(0)
+        , mNumCached(0)
+        , mCurrent(NULL)
+        , mSegments(NULL)
+        , mCache(NULL)
+    {
+    }
+
+    void* x_allocator_forward_segmented::v_allocate(u32 size, u32 alignment)
+    {
+        if (size >= mSegmentSize)
+            return NULL;
+
+        // Empty segments are checked for retirement every 64 allocations
+        ++mTick;
+        if (mNumEmpty > 0 && (mTick & 63) == 0)
+            retire_segments();
+
+        if (mCurrent != NULL)
+        {
+            void* ptr = mCurrent->mForward.allocate(size, alignment);
+            if (ptr != NULL)
+                return ptr;
+        }
+
+        // The current segment is full, continue in another one
+        segment_t* segment = acquire_segment();
+        if (segment == NULL)
+            return NULL;
+
+        void* ptr = segment->mForward.allocate(size, alignment);
+        if (ptr == NULL)
+        {
+            // Does not fit even in an empty segment, the segment is left empty and retires like any other
+            segment->mEmptySince = mTick;
+            ++mNumEmpty;
+            return NULL;
+        }
+        mCurrent = segment;
+        return ptr;
+    }
+
+    u32 x_allocator_forward_segmented::v_deallocate(void* ptr)
+    {
+        if (ptr == NULL)
+            return 0;
+
+        segment_t* segment = find_segment(ptr);
+        ASSERT(segment != NULL);
+        u32 const size = segment->mForward.deallocate(ptr);
+        if (segment != mCurrent && segment->mForward.num_allocations() == 0)
+        {
+            // Start the hysteresis period of this segment
+            segment->mEmptySince = mTick;
+            ++mNumEmpty;
+        }
+        return size;
+    }
+
+    void x_allocator_forward_segmented::v_commit(void* ptr, u32 size)
+    {
+        segment_t* segment = find_segment(ptr);
+        ASSERT(segment != NULL);
+        segment->mForward.commit(ptr, size);
+    }
+
+    u32 x_allocator_forward_segmented::v_usable_size(void* ptr) const
+    {
+        segment_t* segment = find_segment(ptr);
+        ASSERT(segment != NULL);
+        return segment->mForward.get_size(ptr);
+    }
+
+    x_allocator_forward_segmented::segment_t* x_allocator_forward_segmented::find_segment(void* ptr) const
+    {
+        if (mCurrent != NULL && mCurrent->mForward.owns(ptr))
+            return mCurrent;
+        for (segment_t* segment = mSegments; segment != NULL; segment = segment->mNext)
+        {
+            if (segment->mForward.owns(ptr))
+                return segment;
+        }
+        return NULL;
+    }
+
+    x_allocator_forward_segmented::segment_t* x_allocator_forward_segmented::acquire_segment()
+    {
+        // An empty active segment can be used again without touching the parent allocator
+        for (segment_t* segment = mSegments; segment != NULL; segment = segment->mNext)
+        {
+            if (segment != mCurrent && segment->mForward.num_allocations() == 0)
+            {
+                segment->mForward.reset();
+                return segment;
+            }
+        }
+
+        segment_t* segment = mCache;
+        if (segment != NULL)
+        {
+            mCache = segment->mNext;
+            --mNumCached;
+        }
+        else
+        {
+            xbyte* mem = (xbyte*)mAllocator->allocate(sizeof(segment_t) + mSegmentSize, sizeof(void*));
+            if (mem == NULL)
+                return NULL;
+            segment        = new (mem) segment_t();
+            xbyte* begin   = mem + sizeof(segment_t);
+            segment->mForward.init(begin, begin + mSegmentSize);
+        }
+
+        segment->mForward.reset();
+        segment->mNext = mSegments;
+        mSegments      = segment;
+        return segment;
+    }
+
+    // Empty segments that were not used again during the retire delay move to the cache or are released
+    void x_allocator_forward_segmented::retire_segments()
+    {
+        mNumEmpty        = 0;
+        segment_t** link = &mSegments;
+        while (*link != NULL)
+        {
+            segment_t* segment = *link;
+            if (segment != mCurrent && segment->mForward.num_allocations() == 0 && (mTick - segment->mEmptySince) >= mRetireDelay)
+            {
+                *link = segment->mNext;
+                if (mNumCached < mMaxCached)
+                {
+                    segment->mNext = mCache;
+                    mCache         = segment;
+                    ++mNumCached;
+                }
+                else
+                {
+                    segment->~segment_t();
+                    mAllocator->deallocate(segment);
+                }
+            }
+            else
+            {
+                if (segment != mCurrent && segment->mForward.num_allocations() == 0)
+                    ++mNumEmpty;
+                link = &segment->mNext;
+            }
+        }
+    }
+
+    void x_allocator_forward_segmented::v_release()
+    {
+        segment_t* lists[] = {mSegments, mCache};
+        for (s32 i = 0; i < 2; ++i)
+        {
+            segment_t* segment = lists[i];
+            while (segment != NULL)
+            {
+                segment_t* next = segment->mNext;
+                segment->~segment_t();
+                mAllocator->deallocate(segment);
+                segment = next;
+            }
+        }
+
+        alloc_t* allocator = mAllocator;
+        this->~x_allocator_forward_segmented();
+        allocator->deallocate(this);
+    }
+
+    forward_alloc_t* gCreateSegmentedForwardAllocator(alloc_t* allocator, u32 segment_size, u32 max_cached, u32 retire_delay)
+    {
+        void* mem = allocator->allocate(sizeof(x_allocator_forward_segmented), sizeof(void*));
+        return new (mem) x_allocator_forward_segmented(allocator, segment_size, max_cached, retire_delay);
+    }
 }; // namespace xcore
@@ -0,0 +1,212 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+
+#include "xallocator/x_allocator_forward.h"
+#include "xallocator/private/x_atomic.h"
+
+namespace xcore
+{
+    // Multi-producer forward allocator
+    //
+    // The memory is divided into segments, at any time one segment is 'current' and allocations
+    // are bumped from it. The head is a single 64-bit word that holds the current segment and the
+    // offset in it, so an allocation is reserved with one fetch_add on the head:
+    //
+    //     [63..48] generation  [47..40] segment  [39..0] offset
+    //
+    // A fetch_add that ends beyond the segment fails, the offset then only grows and every following
+    // fetch_add on this segment fails as well. The producer that failed first knows the exact number
+    // of bytes that were handed out, it 'seals' the segment with that amount. Any producer that sees
+    // an exhausted head installs a free segment with a compare-and-swap.
+    //
+    // Every segment has a balance counter, a free subtracts the allocated size and sealing adds the
+    // total. The balance can only reach zero once the segment has been sealed and all its memory has
+    // been freed, whoever brings it to zero gives the segment back to the free mask.
+    class x_allocator_forward_mp : public alloc_t
+    {
+    public:
+        enum
+        {
+            MAX_SEGMENTS  = 64,
+            OFFSET_BITS   = 40,
+            SEGMENT_SHIFT = 40,
+            SEGMENT_MASK  = 0xff,
+            GEN_SHIFT     = 48,
+            HEADER_SIZE   = 4,
+            CACHE_LINE    = 64,
+        };
+
+        x_allocator_forward_mp(alloc_t* allocator, xbyte* memory, u32 segment_size, u32 num_segments, xbyte* segments);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Forward, Concurrent]"; }
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_release();
+
+        // Per segment counter, on its own cache line
+        struct segment_t
+        {
+            s64 volatile mBalance;
+            xbyte        mPadding[CACHE_LINE - sizeof(s64)];
+        };
+
+        static inline u64 head_offset(u64 head) { return head & (((u64)1 << OFFSET_BITS) - 1); }
+        static inline u32 head_segment(u64 head) { return (u32)(head >> SEGMENT_SHIFT) & SEGMENT_MASK; }
+        static inline u64 head_make(u64 head, u32 segment) { return ((((head >> GEN_SHIFT) + 1) << GEN_SHIFT)) | ((u64)segment << SEGMENT_SHIFT); }
+
+        bool install(u64 head);
+        void seal(u32 segment, u64 size);
+        void release_bytes(u32 segment, s64 size);
+
+    private:
+        // The head and the free mask are on their own cache lines
+        xbyte        mPadding0[CACHE_LINE];
+        u64 volatile mHead;
+        xbyte        mPadding1[CACHE_LINE - sizeof(u64)];
+        u64 volatile mFreeSegments;
+        alloc_t*     mAllocator;
+        xbyte*       mMemory;
+        u32          mSegmentSize;
+        u32          mNumSegments;
+        segment_t*   mSegments;
+        xbyte        mPadding2[CACHE_LINE];
+
+        x_allocator_forward_mp(const x_allocator_forward_mp&);
+        x_allocator_forward_mp& operator=(const x_allocator_forward_mp&);
+    };
+
+    x_allocator_forward_mp::x_allocator_forward_mp(alloc_t* allocator, xbyte* memory, u32 segment_size, u32 num_segments, xbyte* segments)
+        : mAllocator(allocator)
+        , mMemory(memory)
+        , mSegmentSize(segment_size)
+        , mNumSegments(num_segments)
+        , mSegments((segment_t*)segments)
+    {
+        for (u32 i = 0; i < mNumSegments; ++i)
+            mSegments[i].mBalance = 0;
+
+        // Segment 0 is current, the others are free
+        mHead         = 0;
+        mFreeSegments = (num_segments == MAX_SEGMENTS) ? ~(u64)1 : ((((u64)1 << num_segments) - 1) & ~(u64)1);
+    }
+
+    void* x_allocator_forward_mp::v_allocate(u32 size, u32 alignment)
+    {
+        alignment = alignment < HEADER_SIZE ? (u32)HEADER_SIZE : alignment;
+        ASSERT((alignment & (alignment - 1)) == 0);
+
+        // Every reservation is a multiple of 4 bytes, the u32 header precedes the aligned pointer.
+        // The segment size is a multiple of the cache line, so the rounding can not overflow.
+        if (size > mSegmentSize || alignment > (mSegmentSize - size))
+            return NULL;
+        u32 const total = xalignUp(size + alignment, (u32)HEADER_SIZE);
+
+        while (true)
+        {
+            u64 head = xatomic::load(&mHead);
+            if (head_offset(head) > mSegmentSize)
+            {
+                if (!install(head))
+                    return NULL;
+                continue;
+            }
+
+            head              = xatomic::fetch_add(&mHead, (u64)total);
+            u64 const offset  = head_offset(head);
+            u32 const segment = head_segment(head);
+            if ((offset + total) <= mSegmentSize)
+            {
+                xbyte* base     = mMemory + ((uptr)segment * mSegmentSize) + (uptr)offset;
+                xbyte* ptr      = (xbyte*)xalignUp((uptr)base + HEADER_SIZE, (uptr)alignment);
+                ((u32*)ptr)[-1] = total;
+                return ptr;
+            }
+
+            // The first producer that overflows the segment seals it
+            if (offset <= mSegmentSize)
+                seal(segment, offset);
+        }
+    }
+
+    u32 x_allocator_forward_mp::v_deallocate(void* ptr)
+    {
+        if (ptr == NULL)
+            return 0;
+
+        ASSERT((xbyte*)ptr > mMemory && (xbyte*)ptr < (mMemory + (uptr)mSegmentSize * mNumSegments));
+        u32 const segment = (u32)(((xbyte*)ptr - mMemory) / mSegmentSize);
+        u32 const total   = ((u32*)ptr)[-1];
+        release_bytes(segment, -(s64)total);
+        return total;
+    }
+
+    bool x_allocator_forward_mp::install(u64 head)
+    {
+        // Take the lowest free segment
+        u64 free_mask = xatomic::load(&mFreeSegments);
+        u64 bit;
+        do
+        {
+            if (free_mask == 0)
+                return false;
+            bit = free_mask & (~free_mask + 1);
+        } while (!xatomic::cas(&mFreeSegments, free_mask, free_mask & ~bit));
+
+        u32 segment = 0;
+        while ((bit >> segment) != 1)
+            ++segment;
+
+        // Another producer may have installed a segment already, then hand ours back
+        if (!xatomic::cas(&mHead, head, head_make(head, segment)))
+            xatomic::fetch_or(&mFreeSegments, bit);
+        return true;
+    }
+
+    void x_allocator_forward_mp::seal(u32 segment, u64 size) { release_bytes(segment, (s64)size); }
+
+    void x_allocator_forward_mp::release_bytes(u32 segment, s64 size)
+    {
+        if ((xatomic::fetch_add(&mSegments[segment].mBalance, size) + size) == 0)
+            xatomic::fetch_or(&mFreeSegments, (u64)1 << segment);
+    }
+
+    void x_allocator_forward_mp::v_release()
+    {
+        alloc_t* allocator = mAllocator;
+        allocator->deallocate(mMemory);
+        allocator->deallocate(mSegments);
+        this->~x_allocator_forward_mp();
+        allocator->deallocate(this);
+    }
+
+    alloc_t* gCreateConcurrentForwardAllocator(alloc_t* allocator, u32 segment_size, u32 num_segments)
+    {
+        ASSERT(num_segments >= 2 && num_segments <= x_allocator_forward_mp::MAX_SEGMENTS);
+        if (num_segments < 2 || num_segments > x_allocator_forward_mp::MAX_SEGMENTS)
+            return NULL;
+        if (segment_size == 0 || segment_size > (0xffffffff / num_segments) - x_allocator_forward_mp::CACHE_LINE)
+            return NULL;
+        segment_size = xalignUp(segment_size, (u32)x_allocator_forward_mp::CACHE_LINE);
+
+        void*  mem      = allocator->allocate(sizeof(x_allocator_forward_mp), x_allocator_forward_mp::CACHE_LINE);
+        xbyte* memory   = (xbyte*)allocator->allocate(segment_size * num_segments, x_allocator_forward_mp::CACHE_LINE);
+        xbyte* segments = (xbyte*)allocator->allocate(x_allocator_forward_mp::CACHE_LINE * num_segments, x_allocator_forward_mp::CACHE_LINE);
+        if (mem == NULL || memory == NULL || segments == NULL)
+        {
+            if (segments != NULL)
+                allocator->deallocate(segments);
+            if (memory != NULL)
+                allocator->deallocate(memory);
+            if (mem != NULL)
+                allocator->deallocate(mem);
+            return NULL;
+        }
+        return new (mem) x_allocator_forward_mp(allocator, memory, segment_size, num_segments, segments);
+    }
+}; // namespace xcore
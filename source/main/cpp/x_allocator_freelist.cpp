@@ -4,6 +4,8 @@
 #include "xbase/x_integer.h"
 #include "xbase/x_allocator.h"
 
+#include "xallocator/x_fsadexed_array.h"
+#include "xallocator/x_occupancy.h"
 #include "xallocator/private/x_freelist.h"
 
 namespace xcore
@@ -40,6 +42,12 @@ namespace xcore
             void clear();
             void exit();
 
+            // Allocates an occupancy bitmap from @mAllocator and keeps it up-to-date from now on
+            xoccupancy_t track_occupancy();
+
+            // Switches to the lowest-index-first policy, the bitmap words are allocated from @mAllocator
+            void use_lowest_index_first();
+
             virtual u32   v_size() const { return mAllocCount; }
             virtual void* v_allocate();
             virtual u32   v_deallocate(void* p);
@@ -56,6 +64,8 @@ namespace xcore
             alloc_t*    mAllocator;
             void*       mElementArray;
             xfreelist_t mFreeList;
+            u64*        mOccupancy;
+            u64*        mFreeSetWords;
             u32         mElemSize;
             u32         mAllocCount;
 
@@ -65,15 +75,15 @@ namespace xcore
             xallocator_imp& operator=(const xallocator_imp&);
         };
 
-        xallocator_imp::xallocator_imp() : mAllocator(NULL), mElementArray(NULL), mFreeList(), mAllocCount(0) {}
+        xallocator_imp::xallocator_imp() : mAllocator(NULL), mElementArray(NULL), mFreeList(), mOccupancy(NULL), mFreeSetWords(NULL), mAllocCount(0) {}
 
-        xallocator_imp::xallocator_imp(alloc_t* allocator, u32 inElemSize, u32 inElemAlignment, u32 inMaxNumElements) : mAllocator(allocator), mElementArray(NULL), mFreeList(), mAllocCount(0)
+        xallocator_imp::xallocator_imp(alloc_t* allocator, u32 inElemSize, u32 inElemAlignment, u32 inMaxNumElements) : mAllocator(allocator), mElementArray(NULL), mFreeList(), mOccupancy(NULL), mFreeSetWords(NULL), mAllocCount(0)
         {
             mElemSize = inElemSize;
             mFreeList.init_with_alloc(allocator, inElemSize, inElemAlignment, inMaxNumElements);
         }
 
-        xallocator_imp::xallocator_imp(alloc_t* allocator, void* inElementArray, u32 inElemSize, u32 inElemAlignment, u32 inMaxNumElements) : mAllocator(allocator), mElementArray(inElementArray), mFreeList(), mAllocCount(0)
+        xallocator_imp::xallocator_imp(alloc_t* allocator, void* inElementArray, u32 inElemSize, u32 inElemAlignment, u32 inMaxNumElements) : mAllocator(allocator), mElementArray(inElementArray), mFreeList(), mOccupancy(NULL), mFreeSetWords(NULL), mAllocCount(0)
         {
             mElemSize = inElemSize;
             mFreeList.init_with_array((xcore::xbyte*)inElementArray, inMaxNumElements * inElemSize, inElemSize, inElemAlignment);
@@ -97,6 +107,35 @@ namespace xcore
         {
             ASSERT(mAllocCount == 0);
             mFreeList.release();
+            if (mOccupancy != NULL)
+            {
+                mAllocator->deallocate(mOccupancy);
+                mOccupancy = NULL;
+            }
+            if (mFreeSetWords != NULL)
+            {
+                mAllocator->deallocate(mFreeSetWords);
+                mFreeSetWords = NULL;
+            }
+        }
+
+        xoccupancy_t xallocator_imp::track_occupancy()
+        {
+            if (mOccupancy == NULL)
+            {
+                mOccupancy = (u64*)mAllocator->allocate(xoccupancy_t::num_words(mFreeList.size()) * sizeof(u64), sizeof(u64));
+                mFreeList.init_occupancy(mOccupancy);
+            }
+            return xoccupancy_t(mOccupancy, mFreeList.size());
+        }
+
+        void xallocator_imp::use_lowest_index_first()
+        {
+            if (mFreeSetWords == NULL)
+            {
+                mFreeSetWords = (u64*)mAllocator->allocate(xfreelist_t::lowest_first_words(mFreeList.size()) * sizeof(u64), sizeof(u64));
+                mFreeList.init_lowest_first(mFreeSetWords);
+            }
         }
 
         void* xallocator_imp::v_allocate()
@@ -156,6 +195,9 @@ namespace xcore
             virtual void init() { mAllocator.init(); }
             virtual void clear() { mAllocator.clear(); }
 
+            xoccupancy_t track_occupancy() { return mAllocator.track_occupancy(); }
+            void         use_lowest_index_first() { mAllocator.use_lowest_index_first(); }
+
             virtual u32 v_size() const { return mAllocator.size(); }
 
             virtual u32 iallocate(void*& p)
@@ -192,37 +234,59 @@ namespace xcore
 
         xiallocator_imp::xiallocator_imp(alloc_t* allocator, void* inElementArray, u32 inElemSize, u32 inElemAlignment, u32 inBlockElemCnt) : mOurAllocator(allocator), mAllocator(allocator, inElementArray, inElemSize, inElemAlignment, inBlockElemCnt) {}
 
+        template <class T> static fsadexed_t* sInit(T* allocator, xfreelist_options_t const& options)
+        {
+            if (options.mPolicy == FREELIST_POLICY_LOWEST_INDEX_FIRST)
+                allocator->use_lowest_index_first();
+            allocator->init();
+            if (options.mOccupancy != NULL)
+                *options.mOccupancy = allocator->track_occupancy();
+            return allocator;
+        }
+
     } // namespace xfreelist_allocator
 
     fsadexed_t* gCreateFreeListAllocator(alloc_t* allocator, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements)
     {
-        void*                                mem        = allocator->allocate(sizeof(xfreelist_allocator::xallocator_imp), X_ALIGNMENT_DEFAULT);
-        xfreelist_allocator::xallocator_imp* _allocator = new (mem) xfreelist_allocator::xallocator_imp(allocator, inSizeOfElement, inElementAlignment, inNumElements);
-        _allocator->init();
-        return _allocator;
+        return gCreateFreeListAllocator(allocator, inSizeOfElement, inElementAlignment, inNumElements, xfreelist_options_t());
     }
 
     fsadexed_t* gCreateFreeListAllocator(alloc_t* allocator, void* inElementArray, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements)
     {
-        void*                                mem        = allocator->allocate(sizeof(xfreelist_allocator::xallocator_imp), X_ALIGNMENT_DEFAULT);
-        xfreelist_allocator::xallocator_imp* _allocator = new (mem) xfreelist_allocator::xallocator_imp(allocator, inElementArray, inSizeOfElement, inElementAlignment, inNumElements);
-        _allocator->init();
-        return _allocator;
+        return gCreateFreeListAllocator(allocator, inElementArray, inSizeOfElement, inElementAlignment, inNumElements, xfreelist_options_t());
     }
 
     fsadexed_t* gCreateFreeListIdxAllocator(alloc_t* allocator, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements)
     {
-        void*                                 mem        = allocator->allocate(sizeof(xfreelist_allocator::xiallocator_imp), X_ALIGNMENT_DEFAULT);
-        xfreelist_allocator::xiallocator_imp* _allocator = new (mem) xfreelist_allocator::xiallocator_imp(allocator, inSizeOfElement, inElementAlignment, inNumElements);
-        _allocator->init();
-        return _allocator;
+        return gCreateFreeListIdxAllocator(allocator, inSizeOfElement, inElementAlignment, inNumElements, xfreelist_options_t());
     }
 
     fsadexed_t* gCreateFreeListIdxAllocator(alloc_t* allocator, void* inElementArray, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements)
     {
-        void*                                 mem        = allocator->allocate(sizeof(xfreelist_allocator::xiallocator_imp), X_ALIGNMENT_DEFAULT);
-        xfreelist_allocator::xiallocator_imp* _allocator = new (mem) xfreelist_allocator::xiallocator_imp(allocator, inElementArray, inSizeOfElement, inElementAlignment, inNumElements);
-        _allocator->init();
-        return _allocator;
+        return gCreateFreeListIdxAllocator(allocator, inElementArray, inSizeOfElement, inElementAlignment, inNumElements, xfreelist_options_t());
+    }
+
+    fsadexed_t* gCreateFreeListAllocator(alloc_t* allocator, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements, xfreelist_options_t const& inOptions)
+    {
+        void* mem = allocator->allocate(sizeof(xfreelist_allocator::xallocator_imp), X_ALIGNMENT_DEFAULT);
+        return xfreelist_allocator::sInit(new (mem) xfreelist_allocator::xallocator_imp(allocator, inSizeOfElement, inElementAlignment, inNumElements), inOptions);
+    }
+
+    fsadexed_t* gCreateFreeListAllocator(alloc_t* allocator, void* inElementArray, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements, xfreelist_options_t const& inOptions)
+    {
+        void* mem = allocator->allocate(sizeof(xfreelist_allocator::xallocator_imp), X_ALIGNMENT_DEFAULT);
+        return xfreelist_allocator::sInit(new (mem) xfreelist_allocator::xallocator_imp(allocator, inElementArray, inSizeOfElement, inElementAlignment, inNumElements), inOptions);
+    }
+
+    fsadexed_t* gCreateFreeListIdxAllocator(alloc_t* allocator, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements, xfreelist_options_t const& inOptions)
+    {
+        void* mem = allocator->allocate(sizeof(xfreelist_allocator::xiallocator_imp), X_ALIGNMENT_DEFAULT);
+        return xfreelist_allocator::sInit(new (mem) xfreelist_allocator::xiallocator_imp(allocator, inSizeOfElement, inElementAlignment, inNumElements), inOptions);
+    }
+
+    fsadexed_t* gCreateFreeListIdxAllocator(alloc_t* allocator, void* inElementArray, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements, xfreelist_options_t const& inOptions)
+    {
+        void* mem = allocator->allocate(sizeof(xfreelist_allocator::xiallocator_imp), X_ALIGNMENT_DEFAULT);
+        return xfreelist_allocator::sInit(new (mem) xfreelist_allocator::xiallocator_imp(allocator, inElementArray, inSizeOfElement, inElementAlignment, inNumElements), inOptions);
     }
 }; // namespace xcore
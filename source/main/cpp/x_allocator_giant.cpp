@@ -0,0 +1,299 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+
+#include "xallocator/x_allocator_giant.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+namespace xcore
+{
+#if defined(__linux__)
+    // Giant allocator
+    //
+    // The registry is an open addressing hash table with linear probing, keyed on the page number of
+    // the allocation. It is kept at most half full, a removal shifts the following entries back so
+    // there are no tombstones.
+    class x_allocator_giant : public giant_alloc_t
+    {
+    public:
+        x_allocator_giant(alloc_t* allocator, u32 page_size);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Giant]"; }
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_release();
+        virtual void* v_reallocate(void* ptr, u64 size);
+        virtual bool  v_owns(void const* ptr) const;
+        virtual u64   v_size_of(void const* ptr) const;
+        virtual u32   v_usable_size(void* ptr) const;
+
+        struct entry_t
+        {
+            xbyte* mPtr; // NULL when the entry is empty
+            u64    mSize;
+            u64    mAlignment;
+        };
+
+        inline u32 hash(void const* ptr) const
+        {
+            u64 key = (u64)(uptr)ptr >> mPageShift;
+            key ^= key >> 33;
+            key *= 0xff51afd7ed558ccdull;
+            key ^= key >> 33;
+            return (u32)key & (mCapacity - 1);
+        }
+
+        entry_t* find(void const* ptr) const;
+        bool     insert(xbyte* ptr, u64 size, u64 alignment);
+        void     remove(entry_t* entry);
+        bool     grow();
+
+        xbyte* map(u64 size, u64 alignment, xbyte* old_ptr, u64 old_size);
+
+    private:
+        alloc_t* mAllocator;
+        entry_t* mEntries;
+        u32      mCapacity;
+        u32      mCount;
+        u32      mPageSize;
+        u32      mPageShift;
+
+        x_allocator_giant(const x_allocator_giant&);
+        x_allocator_giant& operator=(const x_allocator_giant&);
+    };
+
+    x_allocator_giant::x_allocator_giant(alloc_t* allocator, u32 page_size)
+        : mAllocator(allocator)
+        , mEntries(NULL)
+        , mCapacity(0)
+        , mCount(0)
+        , mPageSize(page_size)
+        , mPageShift(0)
+    {
+        while (((u32)1 << mPageShift) < page_size)
+            ++mPageShift;
+    }
+
+    x_allocator_giant::entry_t* x_allocator_giant::find(void const* ptr) const
+    {
+        if (mCount == 0)
+            return NULL;
+        for (u32 i = hash(ptr);; i = (i + 1) & (mCapacity - 1))
+        {
+            entry_t* entry = &mEntries[i];
+            if (entry->mPtr == ptr)
+                return entry;
+            if (entry->mPtr == NULL)
+                return NULL;
+        }
+    }
+
+    bool x_allocator_giant::insert(xbyte* ptr, u64 size, u64 alignment)
+    {
+        if (((mCount + 1) * 2) > mCapacity && !grow())
+            return false;
+
+        u32 i = hash(ptr);
+        while (mEntries[i].mPtr != NULL)
+            i = (i + 1) & (mCapacity - 1);
+        mEntries[i].mPtr       = ptr;
+        mEntries[i].mSize      = size;
+        mEntries[i].mAlignment = alignment;
+        mCount += 1;
+        return true;
+    }
+
+    void x_allocator_giant::remove(entry_t* entry)
+    {
+        // Move back every following entry that would not be found anymore once this slot is empty
+        u32 hole = (u32)(entry - mEntries);
+        u32 i    = hole;
+        while (true)
+        {
+            i = (i + 1) & (mCapacity - 1);
+            if (mEntries[i].mPtr == NULL)
+                break;
+            u32 const home = hash(mEntries[i].mPtr);
+            if (((i - home) & (mCapacity - 1)) >= ((i - hole) & (mCapacity - 1)))
+            {
+                mEntries[hole] = mEntries[i];
+                hole           = i;
+            }
+        }
+        mEntries[hole].mPtr = NULL;
+        mCount -= 1;
+    }
+
+    bool x_allocator_giant::grow()
+    {
+        u32 const capacity = mCapacity == 0 ? 64 : mCapacity * 2;
+        entry_t*  entries  = (entry_t*)mAllocator->allocate(capacity * sizeof(entry_t), sizeof(void*));
+        if (entries == NULL)
+            return false;
+        for (u32 i = 0; i < capacity; ++i)
+            entries[i].mPtr = NULL;
+
+        entry_t* const old_entries  = mEntries;
+        u32 const      old_capacity = mCapacity;
+        mEntries                    = entries;
+        mCapacity                   = capacity;
+        mCount                      = 0;
+        for (u32 i = 0; i < old_capacity; ++i)
+        {
+            if (old_entries[i].mPtr != NULL)
+                insert(old_entries[i].mPtr, old_entries[i].mSize, old_entries[i].mAlignment);
+        }
+        if (old_entries != NULL)
+            mAllocator->deallocate(old_entries);
+        return true;
+    }
+
+    // Maps @size bytes aligned on @alignment. With @old_ptr the pages of the old block are moved to the
+    // new place, the old mapping is gone afterwards.
+    xbyte* x_allocator_giant::map(u64 size, u64 alignment, xbyte* old_ptr, u64 old_size)
+    {
+        if (alignment <= mPageSize)
+        {
+            void* mem;
+            if (old_ptr == NULL)
+                mem = mmap(NULL, (size_t)size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            else
+                mem = mremap(old_ptr, (size_t)old_size, (size_t)size, MREMAP_MAYMOVE);
+            return mem == MAP_FAILED ? NULL : (xbyte*)mem;
+        }
+
+        // Reserve enough address space to find an aligned place and give back the head and the tail
+        u64 const total = size + alignment - mPageSize;
+        void*     mem   = mmap(NULL, (size_t)total, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+        if (mem == MAP_FAILED)
+            return NULL;
+        xbyte* const begin = (xbyte*)mem;
+        xbyte* const ptr   = (xbyte*)xalignUp((uptr)begin, (uptr)alignment);
+        xbyte* const end   = begin + total;
+        if (ptr != begin)
+            munmap(begin, (size_t)(ptr - begin));
+        if ((ptr + size) != end)
+            munmap(ptr + size, (size_t)(end - (ptr + size)));
+
+        if (old_ptr == NULL)
+        {
+            if (mprotect(ptr, (size_t)size, PROT_READ | PROT_WRITE) == 0)
+                return ptr;
+        }
+        else
+        {
+            // Replaces the reserved range
+            if (mremap(old_ptr, (size_t)old_size, (size_t)size, MREMAP_MAYMOVE | MREMAP_FIXED, ptr) != MAP_FAILED)
+                return ptr;
+        }
+        munmap(ptr, (size_t)size);
+        return NULL;
+    }
+
+    void* x_allocator_giant::v_allocate(u32 size, u32 alignment)
+    {
+        u64 const mapped = xalignUp((u64)(size == 0 ? 1 : size), (u64)mPageSize);
+        xbyte*    ptr    = map(mapped, alignment, NULL, 0);
+        if (ptr == NULL)
+            return NULL;
+        if (!insert(ptr, mapped, alignment))
+        {
+            munmap(ptr, (size_t)mapped);
+            return NULL;
+        }
+        return ptr;
+    }
+
+    u32 x_allocator_giant::v_deallocate(void* ptr)
+    {
+        if (ptr == NULL)
+            return 0;
+        entry_t* entry = find(ptr);
+        ASSERT(entry != NULL);
+        u64 const size = entry->mSize;
+        munmap(entry->mPtr, (size_t)size);
+        remove(entry);
+        return size > 0xffffffff ? 0xffffffff : (u32)size;
+    }
+
+    void* x_allocator_giant::v_reallocate(void* ptr, u64 size)
+    {
+        if (ptr == NULL)
+            return size <= 0xffffffff ? v_allocate((u32)size, mPageSize) : NULL;
+
+        entry_t* entry = find(ptr);
+        ASSERT(entry != NULL);
+
+        u64 const mapped = xalignUp((u64)(size == 0 ? 1 : size), (u64)mPageSize);
+        if (mapped == entry->mSize)
+            return ptr;
+
+        // Shrinking or growing in place keeps the pointer, otherwise the pages move
+        xbyte* new_ptr = (xbyte*)mremap(entry->mPtr, (size_t)entry->mSize, (size_t)mapped, 0);
+        if (new_ptr == (xbyte*)MAP_FAILED)
+        {
+            new_ptr = map(mapped, entry->mAlignment, entry->mPtr, entry->mSize);
+            if (new_ptr == NULL)
+                return NULL;
+        }
+
+        if (new_ptr == entry->mPtr)
+        {
+            entry->mSize = mapped;
+            return new_ptr;
+        }
+
+        u64 const alignment = entry->mAlignment;
+        remove(entry);
+        insert(new_ptr, mapped, alignment); // Never grows, an entry was just removed
+        return new_ptr;
+    }
+
+    bool x_allocator_giant::v_owns(void const* ptr) const { return find(ptr) != NULL; }
+
+    u64 x_allocator_giant::v_size_of(void const* ptr) const
+    {
+        entry_t const* entry = find(ptr);
+        return entry != NULL ? entry->mSize : 0;
+    }
+
+    u32 x_allocator_giant::v_usable_size(void* ptr) const
+    {
+        u64 const size = v_size_of(ptr);
+        return size > 0xffffffff ? 0xffffffff : (u32)size;
+    }
+
+    void x_allocator_giant::v_release()
+    {
+        for (u32 i = 0; i < mCapacity; ++i)
+        {
+            if (mEntries[i].mPtr != NULL)
+                munmap(mEntries[i].mPtr, (size_t)mEntries[i].mSize);
+        }
+        alloc_t* allocator = mAllocator;
+        if (mEntries != NULL)
+            allocator->deallocate(mEntries);
+        this->~x_allocator_giant();
+        allocator->deallocate(this);
+    }
+
+    giant_alloc_t* gCreateGiantAllocator(alloc_t* allocator)
+    {
+        void* mem = allocator->allocate(sizeof(x_allocator_giant), sizeof(void*));
+        return new (mem) x_allocator_giant(allocator, (u32)sysconf(_SC_PAGESIZE));
+    }
+
+#else
+    giant_alloc_t* gCreateGiantAllocator(alloc_t*) { return NULL; }
+#endif
+
+}; // namespace xcore
@@ -0,0 +1,371 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+
+#include "xallocator/x_allocator_ext.h"
+#include "xallocator/x_allocator_medium.h"
+#include "xallocator/x_occupancy.h"
+
+namespace xcore
+{
+    // Page-run allocator for medium sizes
+    //
+    // The memory is divided in pages and every page belongs to a span, a span is either free or a run
+    // of one size class. The span descriptor lives in mSpans at the index of the first page of the span,
+    // the page map holds for every page the first page of its span. For a run the page map is set for
+    // every page (a free can point anywhere in the run), for a free span only the first and the last
+    // page are needed, that is enough to merge with the neighbours.
+    //
+    // Free spans are kept in lists by length, the last list holds all spans of MAX_SPAN_LISTS-1 pages or
+    // more. Size class c has slots of (MIN_SIZE << (c / 4)) * (4 + c % 4) / 4 bytes.
+    class x_allocator_medium : public alloc_ext_t
+    {
+    public:
+        enum
+        {
+            PAGE_SHIFT       = 12,
+            PAGE_SIZE        = 1 << PAGE_SHIFT,
+            MIN_SIZE_SHIFT   = 11,
+            MIN_SIZE         = 1 << MIN_SIZE_SHIFT,
+            MAX_SIZE         = 256 * 1024,
+            NUM_CLASSES      = 29,
+            MAX_SLOTS        = 64,
+            MIN_RUN_PAGES    = 16,
+            MAX_SPAN_LISTS   = 128,
+            NIL              = 0xffffffff,
+            FREE_SPAN        = 0xffffffff,
+        };
+
+        struct span_t
+        {
+            u32 mPages;
+            u32 mClass; // FREE_SPAN or the size class of the run
+            u32 mPrev;
+            u32 mNext;
+            u32 mNumFree;
+            u32 mNumSlots;
+            u64 mFreeSlots;
+        };
+
+        x_allocator_medium(alloc_t* allocator, xbyte* memory, u32 num_pages, u32* page_map, span_t* spans);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Medium]"; }
+
+        static inline u32 class_size(u32 c) { return ((u32)MIN_SIZE << (c >> 2)) / 4 * (4 + (c & 3)); }
+
+        // Smallest run of at least MIN_RUN_PAGES pages that wastes at most 1/8, slots beyond MAX_SLOTS are not used
+        static u32 run_pages(u32 c)
+        {
+            u32 const size  = class_size(c);
+            u32       pages = (size + PAGE_SIZE - 1) >> PAGE_SHIFT;
+            pages           = pages < MIN_RUN_PAGES ? (u32)MIN_RUN_PAGES : pages;
+            while (((pages << PAGE_SHIFT) % size) * 8 > (pages << PAGE_SHIFT))
+                ++pages;
+            return pages;
+        }
+
+        // The memory has to hold at least one run of every size class
+        static u32 min_pages()
+        {
+            u32 pages = 0;
+            for (u32 c = 0; c < NUM_CLASSES; ++c)
+                pages = run_pages(c) > pages ? run_pages(c) : pages;
+            return pages;
+        }
+        static inline u32 size_to_class(u32 size)
+        {
+            if (size <= MIN_SIZE)
+                return 0;
+            u32 const v   = size - 1;
+            u32 const msb = (u32)xoccupancy_t::find_last_bit(v);
+            return ((msb - MIN_SIZE_SHIFT) << 2) + ((v >> (msb - 2)) & 3) + 1;
+        }
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_release();
+        virtual u32   v_usable_size(void* ptr) const;
+
+        void link(u32& head, u32 span);
+        void unlink(u32& head, u32 span);
+
+        inline u32 span_list(u32 pages) const { return pages < MAX_SPAN_LISTS ? pages : (u32)MAX_SPAN_LISTS - 1; }
+        void       insert_free_span(u32 first, u32 pages);
+        void       remove_free_span(u32 first);
+        u32        alloc_span(u32 pages);
+        void       free_span(u32 first, u32 pages);
+        u32        new_run(u32 c);
+
+    private:
+        alloc_t* mAllocator;
+        xbyte*   mMemory;
+        u32      mNumPages;
+        u32*     mPageMap;
+        span_t*  mSpans;
+        u32      mRunPages[NUM_CLASSES];
+        u32      mRuns[NUM_CLASSES]; // Runs with at least one free slot
+        u32      mFreeSpans[MAX_SPAN_LISTS];
+        u64      mFreeSpanMask[MAX_SPAN_LISTS / 64];
+
+        x_allocator_medium(const x_allocator_medium&);
+        x_allocator_medium& operator=(const x_allocator_medium&);
+    };
+
+    x_allocator_medium::x_allocator_medium(alloc_t* allocator, xbyte* memory, u32 num_pages, u32* page_map, span_t* spans)
+        : mAllocator(allocator)
+        , mMemory(memory)
+        , mNumPages(num_pages)
+        , mPageMap(page_map)
+        , mSpans(spans)
+    {
+        for (u32 c = 0; c < NUM_CLASSES; ++c)
+        {
+            mRunPages[c] = run_pages(c);
+            mRuns[c]     = NIL;
+        }
+
+        for (u32 i = 0; i < MAX_SPAN_LISTS; ++i)
+            mFreeSpans[i] = NIL;
+        for (u32 i = 0; i < MAX_SPAN_LISTS / 64; ++i)
+            mFreeSpanMask[i] = 0;
+
+        insert_free_span(0, num_pages);
+    }
+
+    void x_allocator_medium::link(u32& head, u32 span)
+    {
+        mSpans[span].mPrev = NIL;
+        mSpans[span].mNext = head;
+        if (head != NIL)
+            mSpans[head].mPrev = span;
+        head = span;
+    }
+
+    void x_allocator_medium::unlink(u32& head, u32 span)
+    {
+        span_t& s = mSpans[span];
+        if (s.mPrev != NIL)
+            mSpans[s.mPrev].mNext = s.mNext;
+        else
+            head = s.mNext;
+        if (s.mNext != NIL)
+            mSpans[s.mNext].mPrev = s.mPrev;
+    }
+
+    void x_allocator_medium::insert_free_span(u32 first, u32 pages)
+    {
+        mSpans[first].mPages          = pages;
+        mSpans[first].mClass          = FREE_SPAN;
+        mPageMap[first]               = first;
+        mPageMap[first + pages - 1]   = first;
+        u32 const list                = span_list(pages);
+        link(mFreeSpans[list], first);
+        mFreeSpanMask[list >> 6] |= (u64)1 << (list & 63);
+    }
+
+    void x_allocator_medium::remove_free_span(u32 first)
+    {
+        u32 const list = span_list(mSpans[first].mPages);
+        unlink(mFreeSpans[list], first);
+        if (mFreeSpans[list] == NIL)
+            mFreeSpanMask[list >> 6] &= ~((u64)1 << (list & 63));
+    }
+
+    u32 x_allocator_medium::alloc_span(u32 pages)
+    {
+        // First list with spans that are large enough, the last list needs a search
+        u32 list = span_list(pages);
+        u32 span = NIL;
+        for (u32 w = list >> 6; w < (MAX_SPAN_LISTS / 64) && span == NIL; ++w)
+        {
+            u64 mask = mFreeSpanMask[w];
+            if (w == (list >> 6))
+                mask &= ~(((u64)1 << (list & 63)) - 1);
+            while (mask != 0 && span == NIL)
+            {
+                u32 const l = (w << 6) + (u32)xoccupancy_t::find_first_bit(mask);
+                for (u32 s = mFreeSpans[l]; s != NIL; s = mSpans[s].mNext)
+                {
+                    if (mSpans[s].mPages >= pages)
+                    {
+                        span = s;
+                        break;
+                    }
+                }
+                mask &= mask - 1;
+            }
+        }
+        if (span == NIL)
+            return NIL;
+
+        u32 const total = mSpans[span].mPages;
+        remove_free_span(span);
+        if (total > pages)
+            insert_free_span(span + pages, total - pages);
+        mSpans[span].mPages = pages;
+        return span;
+    }
+
+    void x_allocator_medium::free_span(u32 first, u32 pages)
+    {
+        if (first > 0)
+        {
+            u32 const left = mPageMap[first - 1];
+            if (mSpans[left].mClass == FREE_SPAN)
+            {
+                remove_free_span(left);
+                pages += first - left;
+                first = left;
+            }
+        }
+
+        u32 const right = first + pages;
+        if (right < mNumPages && mSpans[right].mClass == FREE_SPAN)
+        {
+            remove_free_span(right);
+            pages += mSpans[right].mPages;
+        }
+
+        insert_free_span(first, pages);
+    }
+
+    u32 x_allocator_medium::new_run(u32 c)
+    {
+        u32 const pages = mRunPages[c];
+        u32       run   = alloc_span(pages);
+        if (run == NIL)
+        {
+            // Give the empty runs that the other classes hold on to back to the free pages and try again
+            for (u32 o = 0; o < NUM_CLASSES; ++o)
+            {
+                u32 const empty = mRuns[o];
+                if (empty != NIL && mSpans[empty].mNumFree == mSpans[empty].mNumSlots)
+                {
+                    unlink(mRuns[o], empty);
+                    free_span(empty, mSpans[empty].mPages);
+                }
+            }
+            run = alloc_span(pages);
+            if (run == NIL)
+                return NIL;
+        }
+
+        for (u32 p = 0; p < pages; ++p)
+            mPageMap[run + p] = run;
+
+        u32 slots = (pages << PAGE_SHIFT) / class_size(c);
+        slots     = slots > MAX_SLOTS ? (u32)MAX_SLOTS : slots;
+
+        span_t& s    = mSpans[run];
+        s.mClass     = c;
+        s.mNumSlots  = slots;
+        s.mNumFree   = slots;
+        s.mFreeSlots = (slots == MAX_SLOTS) ? ~(u64)0 : (((u64)1 << slots) - 1);
+        link(mRuns[c], run);
+        return run;
+    }
+
+    void* x_allocator_medium::v_allocate(u32 size, u32 alignment)
+    {
+        alignment = alignment == 0 ? 1 : alignment;
+        if (size > MAX_SIZE || alignment > PAGE_SIZE)
+            return NULL;
+
+        // Slots are at multiples of the class size from a page boundary, move up to a class that is aligned
+        u32 c = size_to_class(size);
+        while (c < NUM_CLASSES && (class_size(c) & (alignment - 1)) != 0)
+            ++c;
+        if (c >= NUM_CLASSES)
+            return NULL;
+
+        u32 run = mRuns[c];
+        if (run == NIL)
+        {
+            run = new_run(c);
+            if (run == NIL)
+                return NULL;
+        }
+
+        span_t&   s    = mSpans[run];
+        u32 const slot = (u32)xoccupancy_t::find_first_bit(s.mFreeSlots);
+        s.mFreeSlots &= s.mFreeSlots - 1;
+        if (--s.mNumFree == 0)
+            unlink(mRuns[c], run);
+
+        return mMemory + ((uptr)run << PAGE_SHIFT) + (uptr)slot * class_size(c);
+    }
+
+    u32 x_allocator_medium::v_deallocate(void* ptr)
+    {
+        if (ptr == NULL)
+            return 0;
+
+        ASSERT((xbyte*)ptr >= mMemory && (xbyte*)ptr < (mMemory + ((uptr)mNumPages << PAGE_SHIFT)));
+        u32 const offset = (u32)((xbyte*)ptr - mMemory);
+        u32 const run    = mPageMap[offset >> PAGE_SHIFT];
+        span_t&   s      = mSpans[run];
+        ASSERT(s.mClass != FREE_SPAN);
+
+        u32 const c    = s.mClass;
+        u32 const size = class_size(c);
+        u32 const slot = (offset - (run << PAGE_SHIFT)) / size;
+        ASSERT((s.mFreeSlots & ((u64)1 << slot)) == 0);
+        s.mFreeSlots |= (u64)1 << slot;
+
+        if (s.mNumFree++ == 0)
+            link(mRuns[c], run);
+
+        // An empty run goes back to the free pages, unless it is the only run of its class with free slots
+        if (s.mNumFree == s.mNumSlots && (mRuns[c] != run || s.mNext != NIL))
+        {
+            unlink(mRuns[c], run);
+            free_span(run, s.mPages);
+        }
+        return size;
+    }
+
+    u32 x_allocator_medium::v_usable_size(void* ptr) const
+    {
+        ASSERT((xbyte*)ptr >= mMemory && (xbyte*)ptr < (mMemory + ((uptr)mNumPages << PAGE_SHIFT)));
+        span_t const& s = mSpans[mPageMap[((xbyte*)ptr - mMemory) >> PAGE_SHIFT]];
+        ASSERT(s.mClass != FREE_SPAN);
+        return class_size(s.mClass);
+    }
+
+    void x_allocator_medium::v_release()
+    {
+        alloc_t* allocator = mAllocator;
+        allocator->deallocate(mMemory);
+        this->~x_allocator_medium();
+        allocator->deallocate(this);
+    }
+
+    alloc_ext_t* gCreateMediumAllocator(alloc_t* allocator, u32 memsize)
+    {
+        u32 const num_pages = memsize >> x_allocator_medium::PAGE_SHIFT;
+        if (num_pages < x_allocator_medium::min_pages())
+            return NULL;
+
+        u32 const object_size = xalignUp((u32)sizeof(x_allocator_medium), (u32)sizeof(u64));
+        u32 const spans_size  = num_pages * sizeof(x_allocator_medium::span_t);
+        u32 const map_size    = num_pages * sizeof(u32);
+
+        xbyte* memory = (xbyte*)allocator->allocate(num_pages << x_allocator_medium::PAGE_SHIFT, x_allocator_medium::PAGE_SIZE);
+        if (memory == NULL)
+            return NULL;
+        xbyte* mem = (xbyte*)allocator->allocate(object_size + spans_size + map_size, sizeof(u64));
+        if (mem == NULL)
+        {
+            allocator->deallocate(memory);
+            return NULL;
+        }
+
+        x_allocator_medium::span_t* spans    = (x_allocator_medium::span_t*)(mem + object_size);
+        u32*                        page_map = (u32*)(mem + object_size + spans_size);
+        return new (mem) x_allocator_medium(allocator, memory, num_pages, page_map, spans);
+    }
+}; // namespace xcore
@@ -0,0 +1,203 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+
+#include "xallocator/x_allocator_region.h"
+#include "xallocator/private/x_atomic.h"
+
+namespace xcore
+{
+    class x_allocator_region : public alloc_t
+    {
+    public:
+        enum
+        {
+            HEADER_SIZE = 64 // The region header has its own cache line
+        };
+
+        x_allocator_region(alloc_t* allocator, u32 region_size, u32 max_cached);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Region]"; }
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual u32   v_deallocate(void* ptr);
+        virtual void  v_release();
+
+        // Header at the start of every region. The live count includes one reference for as long
+        // as the region is the current region.
+        struct region_t
+        {
+            s32 volatile mLive;
+            region_t*    mNextRecycled;
+            region_t*    mPrev;
+            region_t*    mNext;
+        };
+
+        bool next_region();
+        void release_ref(region_t* region);
+        void drain_recycled();
+        void free_region(region_t* region);
+
+    private:
+        alloc_t*            mAllocator;
+        u32                 mRegionSize;
+        u32                 mMaxCached;
+        u32                 mNumCached;
+        region_t*           mCurrent;
+        xbyte*              mCursor;
+        xbyte*              mEnd;
+        region_t*           mCache;    // Recycled regions ready for use, owner only
+        region_t*           mRegions;  // All regions taken from the parent, owner only
+        region_t* volatile  mRecycled; // Regions recycled by any thread, lock-free stack
+
+        x_allocator_region(const x_allocator_region&);
+        x_allocator_region& operator=(const x_allocator_region&);
+    };
+
+    x_allocator_region::x_allocator_region(alloc_t* allocator, u32 region_size, u32 max_cached)
+        : mAllocator(allocator)
+        , mRegionSize(region_size)
+        , mMaxCached(max_cached)
+        , mNumCached(0)
+        , mCurrent(NULL)
+        , mCursor(NULL)
+        , mEnd(NULL)
+        , mCache(NULL)
+        , mRegions(NULL)
+        , mRecycled(NULL)
+    {
+        ASSERT(region_size > HEADER_SIZE && (region_size & (region_size - 1)) == 0);
+    }
+
+    void* x_allocator_region::v_allocate(u32 size, u32 alignment)
+    {
+        alignment = alignment == 0 ? 1 : alignment;
+        ASSERT((alignment & (alignment - 1)) == 0);
+        if (size > (mRegionSize - HEADER_SIZE) || alignment > (mRegionSize - HEADER_SIZE - size))
+            return NULL;
+
+        while (true)
+        {
+            xbyte* ptr = (xbyte*)(((uptr)mCursor + (alignment - 1)) & ~((uptr)alignment - 1));
+            if (mCurrent != NULL && ptr <= mEnd && (uptr)size <= (uptr)(mEnd - ptr))
+            {
+                mCursor = ptr + size;
+                xatomic::fetch_add(&mCurrent->mLive, (s32)1);
+                return ptr;
+            }
+            if (!next_region())
+                return NULL;
+        }
+    }
+
+    u32 x_allocator_region::v_deallocate(void* ptr)
+    {
+        if (ptr != NULL)
+            release_ref((region_t*)((uptr)ptr & ~((uptr)mRegionSize - 1)));
+        return 0;
+    }
+
+    void x_allocator_region::release_ref(region_t* region)
+    {
+        ASSERT(xatomic::load(&region->mLive) > 0);
+        if (xatomic::fetch_add(&region->mLive, (s32)-1) != 1)
+            return;
+
+        // Last reference, push the region on the recycle stack (only the owner pops, all at once)
+        region_t* head = xatomic::load(&mRecycled);
+        do
+        {
+            region->mNextRecycled = head;
+        } while (!xatomic::cas(&mRecycled, head, region));
+    }
+
+    void x_allocator_region::drain_recycled()
+    {
+        region_t* region = xatomic::exchange(&mRecycled, (region_t*)NULL);
+        while (region != NULL)
+        {
+            region_t* next = region->mNextRecycled;
+            if (mNumCached < mMaxCached)
+            {
+                region->mNextRecycled = mCache;
+                mCache                = region;
+                ++mNumCached;
+            }
+            else
+            {
+                free_region(region);
+            }
+            region = next;
+        }
+    }
+
+    bool x_allocator_region::next_region()
+    {
+        // Drop the 'current' reference of the full region
+        if (mCurrent != NULL)
+        {
+            region_t* full = mCurrent;
+            mCurrent       = NULL;
+            release_ref(full);
+        }
+
+        drain_recycled();
+
+        region_t* region = mCache;
+        if (region != NULL)
+        {
+            mCache = region->mNextRecycled;
+            --mNumCached;
+        }
+        else
+        {
+            region = (region_t*)mAllocator->allocate(mRegionSize, mRegionSize);
+            if (region == NULL)
+                return false;
+            ASSERT(((uptr)region & (mRegionSize - 1)) == 0);
+            region->mPrev = NULL;
+            region->mNext = mRegions;
+            if (mRegions != NULL)
+                mRegions->mPrev = region;
+            mRegions = region;
+        }
+
+        region->mLive         = 1;
+        region->mNextRecycled = NULL;
+        mCurrent              = region;
+        mCursor               = (xbyte*)region + HEADER_SIZE;
+        mEnd                  = (xbyte*)region + mRegionSize;
+        return true;
+    }
+
+    void x_allocator_region::free_region(region_t* region)
+    {
+        if (region->mPrev != NULL)
+            region->mPrev->mNext = region->mNext;
+        else
+            mRegions = region->mNext;
+        if (region->mNext != NULL)
+            region->mNext->mPrev = region->mPrev;
+        mAllocator->deallocate(region);
+    }
+
+    void x_allocator_region::v_release()
+    {
+        while (mRegions != NULL)
+            free_region(mRegions);
+
+        alloc_t* allocator = mAllocator;
+        this->~x_allocator_region();
+        allocator->deallocate(this);
+    }
+
+    alloc_t* gCreateRegionAllocator(alloc_t* allocator, u32 region_size, u32 max_cached)
+    {
+        void* mem = allocator->allocate(sizeof(x_allocator_region), sizeof(void*));
+        return new (mem) x_allocator_region(allocator, region_size, max_cached);
+    }
+}; // namespace xcore
@@ -217,6 +217,10 @@ namespace xcore
     tlsf_t tlsf_create(void* mem);
     tlsf_t tlsf_create_with_pool(void* mem, size_t bytes);
     void   tlsf_destroy(tlsf_t tlsf);
+
+    /* Fit policy (ETlsfFit), set it before the first pool is added. */
+    void tlsf_set_fit(tlsf_t tlsf, int fit);
+    int  tlsf_get_fit(tlsf_t tlsf);
     pool_t tlsf_get_pool(tlsf_t tlsf);
 
     /* Add/remove memory pools. */
@@ -256,6 +260,12 @@ namespace xcore
     {
         /* log2 of number of linear subdivisions of block sizes. */
         SL_INDEX_COUNT_LOG2 = 5,
+
+        /* Number of free blocks an aligned allocation looks at before it over-allocates. */
+        ALIGNED_SEARCH_DEPTH = 16,
+
+        /* Number of free blocks of the exact size class the best-fit and address-ordered policies look at. */
+        FIT_SEARCH_DEPTH = 8,
     };
 
     /* Private constants: do not modify. */
@@ -396,6 +406,9 @@ namespace xcore
 
         /* Head of free lists. */
         block_header_t* blocks[FL_INDEX_COUNT][SL_INDEX_COUNT];
+
+        /* Fit policy, TLSF_FIT_ADDRESS keeps the free lists sorted by address. */
+        int fit;
     };
 
     /* A type used for casting when doing pointer arithmetic. */
@@ -546,11 +559,11 @@ namespace xcore
         ** First, search for a block in the list associated with the given
         ** fl/sl index.
         */
-        unsigned int sl_map = control->sl_bitmap[fl] & (~0 << sl);
+        unsigned int sl_map = control->sl_bitmap[fl] & (~0U << sl);
         if (!sl_map)
         {
             /* No block exists. Search in the next largest first-level list. */
-            const unsigned int fl_map = control->fl_bitmap & (~0 << (fl + 1));
+            const unsigned int fl_map = control->fl_bitmap & (~0U << (fl + 1));
             if (!fl_map)
             {
                 /* No free blocks available, memory has been exhausted. */
@@ -604,11 +617,29 @@ namespace xcore
         block_header_t* current = control->blocks[fl][sl];
         tlsf_assert(current && "free list cannot have a null entry");
         tlsf_assert(block && "cannot insert a null entry into the free list");
+
+        tlsf_assert(block_to_ptr(block) == align_ptr(block_to_ptr(block), ALIGN_SIZE) && "block not aligned properly");
+
+        /*
+        ** An address-ordered list is walked to the first block at a higher
+        ** address, the new block goes in front of it.
+        */
+        if (control->fit == TLSF_FIT_ADDRESS && current != &control->block_null && current < block)
+        {
+            block_header_t* prev = current;
+            while (prev->next_free != &control->block_null && prev->next_free < block)
+                prev = prev->next_free;
+            block->next_free           = prev->next_free;
+            block->prev_free           = prev;
+            prev->next_free->prev_free = block;
+            prev->next_free            = block;
+            return;
+        }
+
         block->next_free   = current;
         block->prev_free   = &control->block_null;
         current->prev_free = block;
 
-        tlsf_assert(block_to_ptr(block) == align_ptr(block_to_ptr(block), ALIGN_SIZE) && "block not aligned properly");
         /*
         ** Insert the new block at the head of the list, and mark the first-
         ** and second-level bitmaps appropriately.
@@ -741,11 +772,47 @@ namespace xcore
         return remaining_block;
     }
 
+    /*
+    ** Look at the first FIT_SEARCH_DEPTH blocks of the exact size class of size,
+    ** best-fit takes the smallest block that fits (stopping at an exact fit) and
+    ** address-ordered the first one, which is the one at the lowest address.
+    */
+    static block_header_t* block_locate_exact(control_t* control, size_t size)
+    {
+        int fl, sl;
+        mapping_insert(size, &fl, &sl);
+        if (!(control->sl_bitmap[fl] & (1U << sl)))
+            return 0;
+
+        block_header_t* best  = 0;
+        block_header_t* block = control->blocks[fl][sl];
+        for (int depth = FIT_SEARCH_DEPTH; depth > 0 && block != &control->block_null; --depth, block = block->next_free)
+        {
+            const size_t bs = block_size(block);
+            if (bs < size || (best && bs >= block_size(best)))
+                continue;
+            best = block;
+            if (bs == size || control->fit == TLSF_FIT_ADDRESS)
+                break;
+        }
+
+        if (best)
+            remove_free_block(control, best, fl, sl);
+        return best;
+    }
+
     static block_header_t* block_locate_free(control_t* control, size_t size)
     {
         int             fl = 0, sl = 0;
         block_header_t* block = 0;
 
+        if (size && control->fit != TLSF_FIT_GOOD)
+        {
+            block = block_locate_exact(control, size);
+            if (block)
+                return block;
+        }
+
         if (size)
         {
             mapping_search(size, &fl, &sl);
@@ -761,6 +828,89 @@ namespace xcore
         return block;
     }
 
+    /*
+    ** The leading gap that aligns the pointer of a free block. A gap must be able to
+    ** hold a free block of its own, a gap that is too small moves on to the next
+    ** aligned address.
+    */
+    static size_t block_align_gap(const block_header_t* block, size_t align)
+    {
+        const size_t gap_minimum = sizeof(block_header_t);
+
+        void*  ptr     = block_to_ptr(block);
+        void*  aligned = align_ptr(ptr, align);
+        size_t gap     = tlsf_cast(size_t, tlsf_cast(tlsfptr_t, aligned) - tlsf_cast(tlsfptr_t, ptr));
+
+        /* If gap size is too small, offset to next aligned boundary. */
+        if (gap && gap < gap_minimum)
+        {
+            const size_t gap_remain   = gap_minimum - gap;
+            const size_t offset       = tlsf_max(gap_remain, align);
+            const void*  next_aligned = tlsf_cast(void*, tlsf_cast(tlsfptr_t, aligned) + offset);
+
+            aligned = align_ptr(next_aligned, align);
+            gap     = tlsf_cast(size_t, tlsf_cast(tlsfptr_t, aligned) - tlsf_cast(tlsfptr_t, ptr));
+        }
+        return gap;
+    }
+
+    /* Can an aligned block of size bytes be cut from this free block. */
+    static int block_fits_aligned(const block_header_t* block, size_t align, size_t size)
+    {
+        const size_t gap = block_align_gap(block, align);
+        if (gap == 0)
+            return block_size(block) >= size;
+        /* The leading gap is split off, which needs room for a block header. */
+        return block_size(block) >= gap + tlsf_max(size, sizeof(block_header_t));
+    }
+
+    /*
+    ** Locate a free block for an aligned allocation. Any block in a list at or above
+    ** the class of size_with_gap fits, whatever its address. The lists from the class
+    ** of size up to there may well hold a block that happens to be placed right (a
+    ** freed aligned block always is), the first ALIGNED_SEARCH_DEPTH blocks of those
+    ** lists are checked before falling back to the over-allocating search.
+    */
+    static block_header_t* block_locate_free_aligned(control_t* control, size_t align, size_t size, size_t size_with_gap)
+    {
+        int fl = 0, sl = 0;
+        int fl_end = FL_INDEX_COUNT, sl_end = 0;
+
+        if (!size)
+            return 0;
+
+        mapping_search(size, &fl, &sl);
+        if (size_with_gap)
+            mapping_search(size_with_gap, &fl_end, &sl_end);
+
+        int depth = ALIGNED_SEARCH_DEPTH;
+        while (depth > 0 && (fl < fl_end || (fl == fl_end && sl < sl_end)))
+        {
+            block_header_t* block = search_suitable_block(control, &fl, &sl);
+            if (!block || fl > fl_end || (fl == fl_end && sl >= sl_end))
+                break;
+
+            for (; block != &control->block_null && depth > 0; block = block->next_free, --depth)
+            {
+                if (block_fits_aligned(block, align, size))
+                {
+                    remove_free_block(control, block, fl, sl);
+                    return block;
+                }
+            }
+
+            /* Continue with the next list. */
+            if (++sl == SL_INDEX_COUNT)
+            {
+                sl = 0;
+                if (++fl == FL_INDEX_COUNT)
+                    return 0;
+            }
+        }
+
+        return block_locate_free(control, size_with_gap);
+    }
+
     static void* block_prepare_used(control_t* control, block_header_t* block, size_t size)
     {
         void* p = 0;
@@ -790,6 +940,8 @@ namespace xcore
                 control->blocks[i][j] = &control->block_null;
             }
         }
+
+        control->fit = TLSF_FIT_GOOD;
     }
 
     /*
@@ -811,7 +963,7 @@ namespace xcore
         }               \
     }
 
-    static void integrity_walker(void* ptr, size_t size, int used, void* user)
+    static void integrity_walker(void* ptr, size_t size, int, void* user)
     {
         block_header_t* block            = block_from_ptr(ptr);
         integrity_t*    integ            = tlsf_cast(integrity_t*, user);
@@ -871,6 +1023,10 @@ namespace xcore
 
                     mapping_insert(block_size(block), &fli, &sli);
                     tlsf_insist(fli == i && sli == j && "block size indexed in wrong list");
+                    if (control->fit == TLSF_FIT_ADDRESS)
+                    {
+                        tlsf_insist((block->next_free == &control->block_null || block < block->next_free) && "free list not address-ordered");
+                    }
                     block = block->next_free;
                 }
             }
@@ -1063,6 +1219,10 @@ namespace xcore
         return tlsf;
     }
 
+    void tlsf_set_fit(tlsf_t tlsf, int fit) { tlsf_cast(control_t*, tlsf)->fit = fit; }
+
+    int tlsf_get_fit(tlsf_t tlsf) { return tlsf_cast(control_t*, tlsf)->fit; }
+
     void tlsf_destroy(tlsf_t tlsf)
     {
         /* Nothing to do. */
@@ -1096,30 +1256,21 @@ namespace xcore
         const size_t size_with_gap = adjust_request_size(adjust + align + gap_minimum, align);
 
         /* If alignment is less than or equals base alignment, we're done. */
-        const size_t aligned_size = (align <= ALIGN_SIZE) ? adjust : size_with_gap;
+        if (align <= ALIGN_SIZE)
+            return block_prepare_used(control, block_locate_free(control, adjust), adjust);
 
-        block_header_t* block = block_locate_free(control, aligned_size);
+        /*
+        ** Look for a free block that can hold the aligned request as it is, only
+        ** when there is none take a block that is large enough for any address.
+        */
+        block_header_t* block = block_locate_free_aligned(control, align, adjust, size_with_gap);
 
         /* This can't be a static assert. */
         tlsf_assert(sizeof(block_header_t) == block_size_min + block_header_overhead);
 
         if (block)
         {
-            void*  ptr     = block_to_ptr(block);
-            void*  aligned = align_ptr(ptr, align);
-            size_t gap     = tlsf_cast(size_t, tlsf_cast(tlsfptr_t, aligned) - tlsf_cast(tlsfptr_t, ptr));
-
-            /* If gap size is too small, offset to next aligned boundary. */
-            if (gap && gap < gap_minimum)
-            {
-                const size_t gap_remain   = gap_minimum - gap;
-                const size_t offset       = tlsf_max(gap_remain, align);
-                const void*  next_aligned = tlsf_cast(void*, tlsf_cast(tlsfptr_t, aligned) + offset);
-
-                aligned = align_ptr(next_aligned, align);
-                gap     = tlsf_cast(size_t, tlsf_cast(tlsfptr_t, aligned) - tlsf_cast(tlsfptr_t, ptr));
-            }
-
+            const size_t gap = block_align_gap(block, align);
             if (gap)
             {
                 tlsf_assert(gap >= gap_minimum && "gap size too small");
@@ -1145,6 +1296,7 @@ namespace xcore
             block_insert(control, block);
             return cursize;
         }
+        return 0;
     }
 
     /*
@@ -1218,7 +1370,7 @@ namespace xcore
         return p;
     }
 
-    class x_allocator_tlsf : public alloc_t
+    class x_allocator_tlsf : public alloc_ext_t
     {
         void*   mPool;
         xsize_t mPoolSize;
@@ -1226,7 +1378,12 @@ namespace xcore
     public:
         virtual const char* name() const { return TARGET_FULL_DESCR_STR " TLSF allocator"; }
 
-        void init(void* mem, s32 mem_size) { mPool = tlsf_create_with_pool(mem, mem_size); }
+        void init(void* mem, s32 mem_size, ETlsfFit fit)
+        {
+            mPool = tlsf_create(mem);
+            tlsf_set_fit(mPool, fit);
+            tlsf_add_pool(mPool, (char*)mem + tlsf_size(), mem_size - tlsf_size());
+        }
 
         virtual void* v_allocate(u32 size, u32 alignment)
         {
@@ -1242,6 +1399,8 @@ namespace xcore
             return 0;
         }
 
+        virtual u32 v_usable_size(void* ptr) const { return (u32)tlsf_block_size(ptr); }
+
         virtual void v_release()
         {
             tlsf_destroy(mPool);
@@ -1249,24 +1408,282 @@ namespace xcore
             mPoolSize = 0;
         }
 
-        void* operator new(xsize_t num_bytes) { return NULL; }
-        void* operator new(xsize_t num_bytes, void* mem) { return mem; }
-        void  operator delete(void* pMem) {}
-        void  operator delete(void* pMem, void*) {}
+        void* operator new(xsize_t) { return NULL; }
+        void* operator new(xsize_t, void* mem) { return mem; }
+        void  operator delete(void*) {}
+        void  operator delete(void*, void*) {}
 
     protected:
         virtual ~x_allocator_tlsf() {}
     };
 
-    alloc_t* gCreateTlsfAllocator(void* mem, u32 memsize)
+    alloc_ext_t* gCreateTlsfAllocator(void* mem, u32 memsize, ETlsfFit fit)
     {
-        x_allocator_tlsf* allocator = new (mem) x_allocator_tlsf();
-
         s32 allocator_class_size = xceilpo2(sizeof(x_allocator_tlsf));
+        if ((u64)memsize < (u64)allocator_class_size + tlsf_size() + tlsf_pool_overhead() + tlsf_block_size_min())
+            return NULL;
+
+        x_allocator_tlsf* allocator = new (mem) x_allocator_tlsf();
         mem                      = (void*)((u8*)mem + allocator_class_size);
 
-        allocator->init(mem, memsize - allocator_class_size);
+        allocator->init(mem, memsize - allocator_class_size, fit);
         return allocator;
     }
 
+    // Growable TLSF heap with child heaps
+    //
+    // Every pool starts with a small header that links it into the pool list of its heap, the rest is
+    // given to the TLSF control with tlsf_add_pool. The heap object and its control are allocated together.
+    // A child heap gets its memory from its parent heap through take() and give(), so the parent knows
+    // which part of its used bytes belongs to children and can leave it out of the rolled up numbers.
+    class x_allocator_tlsf_heap : public tlsf_heap_t
+    {
+    public:
+        x_allocator_tlsf_heap(alloc_t* allocator, x_allocator_tlsf_heap* parent, u32 pool_size, void* control, ETlsfFit fit);
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR " TLSF heap"; }
+
+        static x_allocator_tlsf_heap* create(alloc_t* allocator, x_allocator_tlsf_heap* parent, u32 pool_size, ETlsfFit fit);
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual void*        v_allocate(u32 size, u32 alignment);
+        virtual u32          v_deallocate(void* ptr);
+        virtual void         v_release();
+        virtual u32          v_usable_size(void* ptr) const;
+        virtual tlsf_heap_t* v_create_child(u32 pool_size);
+        virtual void         v_get_stats(stats_t& stats) const;
+
+        struct pool_header_t
+        {
+            pool_header_t* mNext;
+            u64            mSize;
+        };
+
+        void* alloc(u32 size, u32 alignment);
+        bool  grow(u32 size, u32 alignment);
+        void  destroy(bool return_memory);
+        void  accumulate(stats_t& stats) const;
+
+        // Memory of this heap, from the parent heap or the parent allocator
+        void* acquire(u32 size, u32 alignment) { return mParent != NULL ? mParent->take(size, alignment) : mAllocator->allocate(size, alignment); }
+        void  dispose(void* ptr);
+
+        // Parent side of acquire() and dispose()
+        void* take(u32 size, u32 alignment);
+        void  give(void* ptr);
+
+    private:
+        alloc_t*               mAllocator;
+        x_allocator_tlsf_heap* mParent;
+        tlsf_t                 mControl;
+        u32                    mPoolSize;
+        u32                    mNumPools;
+        u64                    mReserved;   // Bytes acquired, the pools and this object
+        u64                    mUsed;       // Bytes allocated from the pools, including mChildBytes
+        u64                    mChildBytes; // Bytes taken by child heaps
+        pool_header_t*         mPools;
+        x_allocator_tlsf_heap* mChildren;
+        x_allocator_tlsf_heap* mPrevSibling;
+        x_allocator_tlsf_heap* mNextSibling;
+
+        x_allocator_tlsf_heap(const x_allocator_tlsf_heap&);
+        x_allocator_tlsf_heap& operator=(const x_allocator_tlsf_heap&);
+    };
+
+    x_allocator_tlsf_heap::x_allocator_tlsf_heap(alloc_t* allocator, x_allocator_tlsf_heap* parent, u32 pool_size, void* control, ETlsfFit fit)
+        : mAllocator(allocator)
+        , mParent(parent)
+        , mControl(tlsf_create(control))
+        , mPoolSize(pool_size)
+        , mNumPools(0)
+        , mReserved(0)
+        , mUsed(0)
+        , mChildBytes(0)
+        , mPools(NULL)
+        , mChildren(NULL)
+        , mPrevSibling(NULL)
+        , mNextSibling(NULL)
+    {
+        tlsf_set_fit(mControl, fit);
+        if (parent != NULL)
+        {
+            mNextSibling = parent->mChildren;
+            if (mNextSibling != NULL)
+                mNextSibling->mPrevSibling = this;
+            parent->mChildren = this;
+        }
+    }
+
+    x_allocator_tlsf_heap* x_allocator_tlsf_heap::create(alloc_t* allocator, x_allocator_tlsf_heap* parent, u32 pool_size, ETlsfFit fit)
+    {
+        u32 const object_size = xalignUp((u32)sizeof(x_allocator_tlsf_heap), (u32)ALIGN_SIZE);
+        u32 const total_size  = object_size + (u32)tlsf_size();
+
+        void* mem = (parent != NULL) ? parent->take(total_size, ALIGN_SIZE) : allocator->allocate(total_size, ALIGN_SIZE);
+        if (mem == NULL)
+            return NULL;
+
+        x_allocator_tlsf_heap* heap = new (mem) x_allocator_tlsf_heap(allocator, parent, pool_size, (xbyte*)mem + object_size, fit);
+        heap->mReserved             = total_size;
+        return heap;
+    }
+
+    void* x_allocator_tlsf_heap::alloc(u32 size, u32 alignment)
+    {
+        if (alignment <= ALIGN_SIZE)
+            return tlsf_malloc(mControl, size);
+        return tlsf_memalign(mControl, alignment, size);
+    }
+
+    void* x_allocator_tlsf_heap::v_allocate(u32 size, u32 alignment)
+    {
+        void* ptr = alloc(size, alignment);
+        if (ptr == NULL)
+        {
+            if (!grow(size, alignment))
+                return NULL;
+            ptr = alloc(size, alignment);
+            if (ptr == NULL)
+                return NULL;
+        }
+        mUsed += tlsf_block_size(ptr);
+        return ptr;
+    }
+
+    u32 x_allocator_tlsf_heap::v_deallocate(void* ptr)
+    {
+        if (ptr == NULL)
+            return 0;
+        u32 const size = (u32)tlsf_free(mControl, ptr);
+        mUsed -= size;
+        return size;
+    }
+
+    u32 x_allocator_tlsf_heap::v_usable_size(void* ptr) const { return (u32)tlsf_block_size(ptr); }
+
+    bool x_allocator_tlsf_heap::grow(u32 size, u32 alignment)
+    {
+        // Room for the request including the alignment gap, the rounding up to the next size class of
+        // the TLSF search and the pool overhead.
+        u64 needed = (u64)size + alignment + tlsf_block_size_min() + tlsf_alloc_overhead();
+        needed += needed >> (SL_INDEX_COUNT_LOG2 - 1);
+        needed += tlsf_pool_overhead() + sizeof(pool_header_t);
+        needed = xalignUp(needed, (u64)ALIGN_SIZE);
+        if (needed > (u64)tlsf_block_size_max())
+            return false;
+
+        u32 const pool_size = needed > mPoolSize ? (u32)needed : mPoolSize;
+        pool_header_t* pool = (pool_header_t*)acquire(pool_size, ALIGN_SIZE);
+        if (pool == NULL)
+            return false;
+
+        pool->mSize = pool_size;
+        if (tlsf_add_pool(mControl, pool + 1, pool_size - sizeof(pool_header_t)) == 0)
+        {
+            dispose(pool);
+            return false;
+        }
+
+        pool->mNext = mPools;
+        mPools      = pool;
+        mNumPools += 1;
+        mReserved += pool_size;
+        return true;
+    }
+
+    void* x_allocator_tlsf_heap::take(u32 size, u32 alignment)
+    {
+        void* ptr = v_allocate(size, alignment);
+        if (ptr != NULL)
+            mChildBytes += tlsf_block_size(ptr);
+        return ptr;
+    }
+
+    void x_allocator_tlsf_heap::give(void* ptr)
+    {
+        mChildBytes -= tlsf_block_size(ptr);
+        v_deallocate(ptr);
+    }
+
+    void x_allocator_tlsf_heap::dispose(void* ptr)
+    {
+        if (mParent != NULL)
+            mParent->give(ptr);
+        else
+            mAllocator->deallocate(ptr);
+    }
+
+    void x_allocator_tlsf_heap::destroy(bool return_memory)
+    {
+        // The memory of the children is in our pools, they don't have to give anything back
+        x_allocator_tlsf_heap* child = mChildren;
+        while (child != NULL)
+        {
+            x_allocator_tlsf_heap* next = child->mNextSibling;
+            child->destroy(false);
+            child = next;
+        }
+        mChildren = NULL;
+
+        if (!return_memory)
+        {
+            this->~x_allocator_tlsf_heap();
+            return;
+        }
+
+        while (mPools != NULL)
+        {
+            pool_header_t* pool = mPools;
+            mPools              = pool->mNext;
+            dispose(pool);
+        }
+
+        x_allocator_tlsf_heap* parent    = mParent;
+        alloc_t*               allocator = mAllocator;
+        tlsf_destroy(mControl);
+        this->~x_allocator_tlsf_heap();
+        if (parent != NULL)
+            parent->give(this);
+        else
+            allocator->deallocate(this);
+    }
+
+    void x_allocator_tlsf_heap::v_release()
+    {
+        if (mParent != NULL)
+        {
+            if (mPrevSibling != NULL)
+                mPrevSibling->mNextSibling = mNextSibling;
+            else
+                mParent->mChildren = mNextSibling;
+            if (mNextSibling != NULL)
+                mNextSibling->mPrevSibling = mPrevSibling;
+        }
+        destroy(true);
+    }
+
+    tlsf_heap_t* x_allocator_tlsf_heap::v_create_child(u32 pool_size) { return create(this, this, pool_size, (ETlsfFit)tlsf_get_fit(mControl)); }
+
+    void x_allocator_tlsf_heap::v_get_stats(stats_t& stats) const
+    {
+        stats.mReserved = mReserved;
+        stats.mUsed     = 0;
+        stats.mPools    = 0;
+        stats.mHeaps    = 0;
+        accumulate(stats);
+    }
+
+    void x_allocator_tlsf_heap::accumulate(stats_t& stats) const
+    {
+        stats.mUsed += mUsed - mChildBytes;
+        stats.mPools += mNumPools;
+        stats.mHeaps += 1;
+        for (x_allocator_tlsf_heap const* child = mChildren; child != NULL; child = child->mNextSibling)
+            child->accumulate(stats);
+    }
+
+    tlsf_heap_t* gCreateTlsfHeap(alloc_t* allocator, u32 pool_size, ETlsfFit fit) { return x_allocator_tlsf_heap::create(allocator, NULL, pool_size, fit); }
+
 }; // namespace xcore
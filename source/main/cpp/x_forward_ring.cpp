@@ -0,0 +1,214 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+
+#include "xallocator/x_forward_ring.h"
+#include "xallocator/private/x_atomic.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace xcore
+{
+    namespace xforwardring
+    {
+        enum
+        {
+            WRAP_MARKER = 0xffffffff
+        };
+
+        struct header_t
+        {
+            u32 mSize;
+            u32 mPadding;
+        };
+
+        static inline u32 record_size(u32 size) { return xalignUp(size + (u32)forward_ring_t::HEADER_SIZE, (u32)forward_ring_t::ALIGNMENT); }
+
+#if defined(__linux__)
+        static u32 page_size() { return (u32)sysconf(_SC_PAGESIZE); }
+
+        // Reserve 2 x size of address space and map the same memfd into both halves
+        static xbyte* map_mirrored(u32 size)
+        {
+            int const fd = (int)syscall(SYS_memfd_create, "xforwardring", 0);
+            if (fd < 0)
+                return NULL;
+
+            xbyte* base = NULL;
+            if (ftruncate(fd, (off_t)size) == 0)
+            {
+                void* reserved = mmap(NULL, (size_t)size * 2, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (reserved != MAP_FAILED)
+                {
+                    base          = (xbyte*)reserved;
+                    void* const a = mmap(base, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+                    void* const b = mmap(base + size, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, fd, 0);
+                    if (a != (void*)base || b != (void*)(base + size))
+                    {
+                        munmap(base, (size_t)size * 2);
+                        base = NULL;
+                    }
+                }
+            }
+            close(fd);
+            return base;
+        }
+
+        static void unmap_mirrored(xbyte* base, u32 size) { munmap(base, (size_t)size * 2); }
+#else
+        static u32    page_size() { return 4096; }
+        static xbyte* map_mirrored(u32) { return NULL; }
+        static void   unmap_mirrored(xbyte*, u32) {}
+#endif
+    } // namespace xforwardring
+
+    forward_ring_t::forward_ring_t(alloc_t* allocator, xbyte* memory, u32 capacity, bool mirrored)
+        : mAllocator(allocator)
+        , mMemory(memory)
+        , mCapacity(capacity)
+        , mMask(capacity - 1)
+        , mMirrored(mirrored)
+        , mPublished(0)
+        , mReleased(0)
+        , mWrite(0)
+        , mCachedReleased(0)
+        , mRead(0)
+        , mCachedPublished(0)
+        , mPeekSize(0)
+    {
+        ASSERT(capacity != 0 && (capacity & (capacity - 1)) == 0);
+    }
+
+    void* forward_ring_t::allocate(u32 size)
+    {
+        // Checked before rounding, size + header would wrap around for sizes close to 4 GB and a
+        // size of 0xffffffff would be stored as a wrap marker
+        if (size > (mCapacity - (u32)HEADER_SIZE))
+            return NULL;
+        u32 const record = xforwardring::record_size(size);
+
+        // Not enough space before the end of the ring, skip the tail and wrap around.
+        // A mirrored ring doesn't need to, the message continues in the second mapping.
+        u32 const offset = mWrite & mMask;
+        u32 const tail   = mCapacity - offset;
+        u32 const needed = (record <= tail || mMirrored) ? record : (tail + record);
+
+        if ((mWrite + needed - mCachedReleased) > mCapacity)
+        {
+            mCachedReleased = xatomic::load(&mReleased);
+            if ((mWrite + needed - mCachedReleased) > mCapacity)
+            {
+                // The tail and the message together may never fit, publish the wrap marker on its own so
+                // that the consumer releases the tail. Only when nothing else is pending, publish() would
+                // expose those messages as well. A retry then allocates at the start of the ring.
+                if (needed != record && mPublished == mWrite && (mWrite + tail - mCachedReleased) <= mCapacity)
+                {
+                    ((xforwardring::header_t*)(mMemory + offset))->mSize = xforwardring::WRAP_MARKER;
+                    mWrite += tail;
+                    publish();
+                }
+                return NULL;
+            }
+        }
+
+        if (needed != record)
+        {
+            ((xforwardring::header_t*)(mMemory + offset))->mSize = xforwardring::WRAP_MARKER;
+            mWrite += tail;
+        }
+
+        xforwardring::header_t* header = (xforwardring::header_t*)(mMemory + (mWrite & mMask));
+        header->mSize                  = size;
+        mWrite += record;
+        return header + 1;
+    }
+
+    void forward_ring_t::publish() { xatomic::store(&mPublished, mWrite); }
+
+    void* forward_ring_t::peek(u32& outSize)
+    {
+        if (mRead == mCachedPublished)
+        {
+            mCachedPublished = xatomic::load(&mPublished);
+            if (mRead == mCachedPublished)
+                return NULL;
+        }
+
+        xforwardring::header_t* header = (xforwardring::header_t*)(mMemory + (mRead & mMask));
+        if (header->mSize == xforwardring::WRAP_MARKER)
+        {
+            // Skip the tail and hand it back, the producer may have published the marker on its own
+            mRead += mCapacity - (mRead & mMask);
+            xatomic::store(&mReleased, mRead);
+            if (mRead == mCachedPublished)
+            {
+                mCachedPublished = xatomic::load(&mPublished);
+                if (mRead == mCachedPublished)
+                    return NULL;
+            }
+            header = (xforwardring::header_t*)mMemory;
+        }
+
+        mPeekSize = header->mSize;
+        outSize   = mPeekSize;
+        return header + 1;
+    }
+
+    void forward_ring_t::deallocate()
+    {
+        ASSERT(mRead != mCachedPublished);
+        mRead += xforwardring::record_size(mPeekSize);
+        xatomic::store(&mReleased, mRead);
+    }
+
+    void forward_ring_t::release()
+    {
+        alloc_t* allocator = mAllocator;
+        if (mMirrored)
+            xforwardring::unmap_mirrored(mMemory, mCapacity);
+        else
+            allocator->deallocate(mMemory);
+        this->~forward_ring_t();
+        allocator->deallocate(this);
+    }
+
+    forward_ring_t* gCreateForwardRing(alloc_t* allocator, u32 memsize)
+    {
+        u32 const capacity = (u32)xceilpo2(memsize < (u32)forward_ring_t::CACHE_LINE ? (u32)forward_ring_t::CACHE_LINE : memsize);
+
+        void*  mem    = allocator->allocate(sizeof(forward_ring_t), forward_ring_t::CACHE_LINE);
+        xbyte* memory = (xbyte*)allocator->allocate(capacity, forward_ring_t::CACHE_LINE);
+        if (mem == NULL || memory == NULL)
+        {
+            if (mem != NULL)
+                allocator->deallocate(mem);
+            if (memory != NULL)
+                allocator->deallocate(memory);
+            return NULL;
+        }
+        return new (mem) forward_ring_t(allocator, memory, capacity);
+    }
+
+    forward_ring_t* gCreateMirroredForwardRing(alloc_t* allocator, u32 memsize)
+    {
+        u32 const page_size = xforwardring::page_size();
+        u32 const capacity  = (u32)xceilpo2(memsize < page_size ? page_size : memsize);
+
+        xbyte* memory = xforwardring::map_mirrored(capacity);
+        if (memory == NULL)
+            return NULL;
+
+        void* mem = allocator->allocate(sizeof(forward_ring_t), forward_ring_t::CACHE_LINE);
+        if (mem == NULL)
+        {
+            xforwardring::unmap_mirrored(memory, capacity);
+            return NULL;
+        }
+        return new (mem) forward_ring_t(allocator, memory, capacity, true);
+    }
+}; // namespace xcore
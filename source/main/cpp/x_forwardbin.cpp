@@ -13,53 +13,77 @@ namespace xcore
         //==============================================================================
         //==============================================================================
         // This is a chunk used in the forward allocator
+        //
+        // Chunks are contiguous, the next chunk directly follows the data of a chunk, so
+        // only the (relative) offset to the previous chunk and the size are stored. The
+        // size is a multiple of 4, the lower 2 bits hold the type of the chunk.
+        // Debug builds add a guard word to validate chunks.
         //==============================================================================
         //==============================================================================
-        struct chunk // 32 bytes
+        struct chunk // 8 bytes, 16 bytes in debug builds
         {
         public:
             enum EMagic
             {
-                CHUNK_MAGIC_BEGIN = 0xF00DBEEF,
-                CHUNK_MAGIC_HEAD  = 0xFEEDFEED,
-                CHUNK_MAGIC_USED  = 0xC0DEC0DE,
-                CHUNK_MAGIC_END   = 0xDEADBEEF
+                CHUNK_MAGIC_BEGIN = 0,
+                CHUNK_MAGIC_HEAD  = 1,
+                CHUNK_MAGIC_USED  = 2,
+                CHUNK_MAGIC_END   = 3,
+                CHUNK_MAGIC_MASK  = 3,
             };
 
-            inline chunk() : magic(CHUNK_MAGIC_USED), size(0) { link[0] = link[1] = 0; }
+#ifdef TARGET_DEBUG
+            enum EGuard
+            {
+                CHUNK_GUARD = 0xF00DBEEF
+            };
+
+            inline chunk() : prev(0), size(CHUNK_MAGIC_USED), guard(CHUNK_GUARD), pad(0) {}
+            inline bool isValid() const { return guard == CHUNK_GUARD; }
+#else
+            inline chunk() : prev(0), size(CHUNK_MAGIC_USED) {}
+            inline bool isValid() const { return true; }
+#endif
 
             inline bool inRange(chunk const* begin, chunk const* end) const { return this >= begin && this <= end; }
-            inline bool isValid() const { return magic == CHUNK_MAGIC_BEGIN || magic == CHUNK_MAGIC_HEAD || magic == CHUNK_MAGIC_USED || magic == CHUNK_MAGIC_END; }
 
-            inline chunk* getNext() const { return link[1]; }
-            inline chunk* getPrev() const { return link[0]; }
-            inline void   setNext(chunk* c) { link[1] = c; }
-            inline void   setPrev(chunk* c) { link[0] = c; }
+            // The 'End' chunk is the last chunk, it has no next
+            inline chunk* getNext() const
+            {
+                ASSERT(getMagic() != CHUNK_MAGIC_END);
+                return (chunk*)((xbyte*)this + sizeof(chunk) + getSize());
+            }
+            inline chunk* getPrev() const { return (chunk*)((xbyte*)this - (sptr)prev); }
+            inline void   setPrev(chunk* c) { prev = (s32)((xbyte*)this - (xbyte*)c); }
 
-            inline u32  getSize() const { return size; }
-            inline void setSize(u32 _size) { size = _size; }
+            inline u32  getSize() const { return size & ~(u32)CHUNK_MAGIC_MASK; }
+            inline void setSize(u32 _size) { size = _size | getMagic(); }
             inline void addSize(u32 _size) { size += _size; }
             inline void subSize(u32 _size) { size -= _size; }
             inline u32  popSize()
             {
-                u32 _size = size;
-                size      = 0;
+                u32 _size = getSize();
+                size      = getMagic();
                 return _size;
             }
 
-            void initialize(chunk* _prev, chunk* _next, u32 _size, u32 _magic)
+            void initialize(chunk* _prev, u32 _size, u32 _magic)
             {
-                magic   = _magic;
-                link[0] = _prev;
-                link[1] = _next;
-                size    = _size;
+                ASSERT((_size & CHUNK_MAGIC_MASK) == 0);
+                setPrev(_prev);
+                size = _size | _magic;
+#ifdef TARGET_DEBUG
+                guard = CHUNK_GUARD;
+                pad   = 0;
+#endif
             }
 
-            void setMagic(u32 _magic) { magic = _magic; }
+            inline u32 getMagic() const { return size & CHUNK_MAGIC_MASK; }
+            void       setMagic(u32 _magic) { size = getSize() | _magic; }
 
             void merge(chunk*& head)
             {
-                // Removing chunk 'c' from the double linked list
+                // Removing chunk 'c' from the list
                 chunk* c    = this;
                 chunk* prev = c->getPrev();
                 chunk* next = c->getNext();
@@ -69,8 +93,7 @@ namespace xcore
                     // Let's move back the head to this chunk this giving it more memory
                     // to allocate from.
                     c->addSize(head->getSize() + sizeof(chunk));
-                    next = head->getNext();
-                    c->setNext(next);
+                    next = c->getNext();
                     c->setMagic(CHUNK_MAGIC_HEAD);
                     next->setPrev(c);
                     head = c;
@@ -80,14 +103,16 @@ namespace xcore
                     // Our previous block is a used block, merge with that one.
                     prev->addSize(c->getSize() + sizeof(chunk));
                     next->setPrev(prev);
-                    prev->setNext(next);
                 }
             }
 
         private:
-            u32    magic;
-            u32    size;
-            chunk* link[2];
+            s32 prev; // Offset from the previous chunk to this chunk
+            u32 size; // Size | Magic
+#ifdef TARGET_DEBUG
+            u32 guard;
+            u32 pad;
+#endif
         };
 
         //==============================================================================
@@ -107,15 +132,16 @@ namespace xcore
             // Coalescing a block at the end with one at the beginning (wrapping around) is something
             // that we are trying to avoid by doing this.
 
+            // Chunk sizes are a multiple of 4
             mBegin = (chunk*)mMemBegin;
-            mEnd   = (chunk*)((xbyte*)mMemEnd - sizeof(chunk));
+            mEnd   = (chunk*)(((uptr)mMemEnd - sizeof(chunk)) & ~(uptr)3);
             mHead  = (chunk*)((xbyte*)mMemBegin + sizeof(chunk));
 
             u32 const free_mem_size = (u32)((xbyte*)mEnd - ((xbyte*)mHead + sizeof(chunk)));
 
-            mBegin->initialize(mEnd, mHead, 0, chunk::CHUNK_MAGIC_BEGIN);
-            mHead->initialize(mBegin, mEnd, free_mem_size, chunk::CHUNK_MAGIC_HEAD);
-            mEnd->initialize(mHead, mBegin, 0, chunk::CHUNK_MAGIC_END);
+            mBegin->initialize(mBegin, 0, chunk::CHUNK_MAGIC_BEGIN);
+            mHead->initialize(mBegin, free_mem_size, chunk::CHUNK_MAGIC_HEAD);
+            mEnd->initialize(mHead, 0, chunk::CHUNK_MAGIC_END);
 
             gIsValidChunk(mBegin, mEnd, mBegin);
             gIsValidChunk(mBegin, mEnd, mHead);
@@ -169,7 +195,7 @@ namespace xcore
 
             // Now fix the linking
             next->setPrev(c);
-            prev->setNext(c);
+            c->setPrev(prev);
 
             gIsValidChunk(begin, end, next);
             gIsValidChunk(begin, end, prev);
@@ -207,10 +233,11 @@ namespace xcore
 
                         // Construct the new head after the allocated chunk
                         chunk* head = (chunk*)((xbyte*)alloc_address + size);
-                        head->initialize(c, c->getNext(), c->getSize() - size - sizeof(chunk), chunk::CHUNK_MAGIC_HEAD);
+                        chunk* next = c->getNext();
+                        head->initialize(c, c->getSize() - size - sizeof(chunk), chunk::CHUNK_MAGIC_HEAD);
+                        next->setPrev(head);
                         gIsValidChunk(mBegin, mEnd, head);
 
-                        c->setNext(head);
                         c->setSize(size);
                         c->setMagic(chunk::CHUNK_MAGIC_USED);
                         gIsValidChunk(mBegin, mEnd, c);
@@ -232,7 +259,7 @@ namespace xcore
                     // If we can can allocate then we must build a new head and merge the old one into a used chunk.
 
                     // see if we can fulfill the allocation request by taking the next free chunk
-                    ASSERT(mHead->getNext() == mEnd && mHead->getNext()->getNext() == mBegin);
+                    ASSERT(mHead->getNext() == mEnd);
 
                     if (mBegin->getSize() > sizeof(chunk) && size <= (mBegin->getSize() - sizeof(chunk)))
                     {
@@ -244,10 +271,12 @@ namespace xcore
                             // Move head by 'diff' number of bytes
                             head = (chunk*)((xbyte*)head + diff);
 
-                            // Configure 'head' and set size of mBegin to '0'
-                            head->initialize(mBegin, mBegin->getNext(), mBegin->getSize() - (diff + sizeof(chunk)), chunk::CHUNK_MAGIC_HEAD);
+                            // Configure 'head', mBegin keeps the 'diff' bytes in front of it
+                            chunk* next = mBegin->getNext();
+                            head->initialize(mBegin, mBegin->getSize() - (diff + sizeof(chunk)), chunk::CHUNK_MAGIC_HEAD);
+                            next->setPrev(head);
                             gIsValidChunk(mBegin, mEnd, head);
-                            mBegin->setSize(0);
+                            mBegin->setSize(diff);
 
                             // Merge Head into it's previous 'used' chunk
                             chunk* dummy = mHead;
@@ -274,6 +303,32 @@ namespace xcore
             return alloc_address;
         }
 
+        // Shrink the chunk of @p to @size, the chunk has to be the last one allocated so that the
+        // remainder can be given back to the head.
+        void xallocator::commit(void* p, u32 size)
+        {
+            chunk* c = (chunk*)((xbyte*)p - sizeof(chunk));
+            gIsValidChunk(mBegin, mEnd, c);
+            ASSERT(c->getNext() == mHead);
+
+            size = xalignUp(size, (u32)4);
+            ASSERT(size <= c->getSize());
+            u32 const diff = c->getSize() - size;
+            if (diff == 0)
+                return;
+
+            // The new head overlaps the old one, read it before constructing
+            chunk* const next      = mHead->getNext();
+            u32 const    head_size = mHead->getSize();
+
+            chunk* head = (chunk*)((xbyte*)mHead - diff);
+            head->initialize(c, head_size + diff, chunk::CHUNK_MAGIC_HEAD);
+            next->setPrev(head);
+            c->setSize(size);
+            gIsValidChunk(mBegin, mEnd, head);
+            mHead = head;
+        }
+
         u32 xallocator::get_size(void* p) const
         {
             chunk const* c = (chunk const*)((xbyte*)p - sizeof(chunk));
@@ -317,13 +372,12 @@ namespace xcore
                 if (mHead->getPrev() == mBegin)
                 {
                     ASSERT(mBegin->getNext() == mHead);
+                    chunk* next = mHead->getNext();
                     mBegin->addSize(mHead->popSize());
-                    mBegin->setNext(mHead->getNext());
 
                     mHead = mBegin + 1;
-                    mHead->initialize(mBegin, mBegin->getNext(), mBegin->popSize(), chunk::CHUNK_MAGIC_HEAD);
-
-                    mBegin->setNext(mHead);
+                    mHead->initialize(mBegin, mBegin->popSize(), chunk::CHUNK_MAGIC_HEAD);
+                    next->setPrev(mHead);
                 }
 
 				return size;
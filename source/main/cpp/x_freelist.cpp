@@ -4,6 +4,7 @@
 #include "xbase/x_integer.h"
 #include "xbase/x_allocator.h"
 
+#include "xallocator/x_occupancy.h"
 #include "xallocator/private/x_freelist.h"
 
 namespace xcore
@@ -23,7 +24,7 @@ namespace xcore
         u32 mIndex;
     };
 
-    xfreelist_t::xfreelist_t() : mAllocator(NULL), mElemSize(0), mElemAlignment(0), mUsed(0), mSize(0), mElementArray(0), mFreeList(NULL) {}
+    xfreelist_t::xfreelist_t() : mAllocator(NULL), mElemSize(0), mElemAlignment(0), mUsed(0), mSize(0), mElementArray(0), mFreeList(NULL), mOccupancy(NULL), mFreeSetWords(NULL) {}
 
     void xfreelist_t::init_with_array(xbyte* array, u32 array_size, u32 elem_size, u32 elem_alignment)
     {
@@ -86,7 +87,19 @@ namespace xcore
 
     void xfreelist_t::init_list()
     {
-        mUsed     = 0;
+        mUsed = 0;
+
+        if (mOccupancy != NULL)
+            x_memset(mOccupancy, 0, xoccupancy_t::num_words(mSize) * sizeof(u64));
+
+        // The lowest-index-first policy only uses the bitset, the linked list is not needed
+        if (mFreeSetWords != NULL)
+        {
+            mFreeList = NULL;
+            mFreeSet.init(mFreeSetWords, mSize, true);
+            return;
+        }
+
         mFreeList = ptr_of(0);
         for (s32 i = 1; i < size(); ++i)
         {
@@ -98,19 +111,62 @@ namespace xcore
         last->setNext(this, NULL);
     }
 
+    void xfreelist_t::init_occupancy(u64* bits)
+    {
+        ASSERT(mUsed == 0);
+        mOccupancy = bits;
+        if (mOccupancy != NULL)
+            x_memset(mOccupancy, 0, xoccupancy_t::num_words(mSize) * sizeof(u64));
+    }
+
+    void xfreelist_t::init_lowest_first(u64* words)
+    {
+        ASSERT(mUsed == 0);
+        mFreeSetWords = words;
+        if (mFreeSetWords == NULL)
+            mFreeSet = xhibitset_t();
+        init_list();
+    }
+
     xfreelist_t::xitem_t* xfreelist_t::alloc()
     {
+        if (mFreeSetWords != NULL)
+        {
+            s32 const idx = mFreeSet.find();
+            if (idx == NULL_INDEX)
+                return NULL;
+            mFreeSet.clr(idx);
+            mUsed++;
+            if (mOccupancy != NULL)
+                xoccupancy_t::set_live(mOccupancy, idx);
+            return ptr_of(idx);
+        }
+
         xitem_t* current = mFreeList;
         if (current != NULL)
         {
             mFreeList = current->getNext(this);
             mUsed++;
+            if (mOccupancy != NULL)
+                xoccupancy_t::set_live(mOccupancy, idx_of(current));
         }
         return current;
     }
 
     void xfreelist_t::free(xitem_t* item)
     {
+        if (mFreeSetWords != NULL)
+        {
+            s32 const idx = idx_of(item);
+            mFreeSet.set(idx);
+            if (mOccupancy != NULL)
+                xoccupancy_t::set_free(mOccupancy, idx);
+            --mUsed;
+            return;
+        }
+
+        if (mOccupancy != NULL)
+            xoccupancy_t::set_free(mOccupancy, idx_of(item));
         item->setNext(this, mFreeList);
         mFreeList = item;
         --mUsed;
@@ -3,16 +3,27 @@
 #include "xbase/x_allocator.h"
 #include "xbase/x_memory.h"
 
+#include "xallocator/x_fsadexed_array.h"
+#include "xallocator/x_occupancy.h"
+
 namespace xcore
 {
     class x_fsadexed_allocator : public fsadexed_t
     {
     public:
-        x_fsadexed_allocator(alloc_t* allocator) : mAllocator(allocator) {}
+        x_fsadexed_allocator(alloc_t* allocator, EIndexWidth index_width = INDEX_WIDTH_32) : mAllocator(allocator), mOccupancy(NULL), mIndexBytes(index_width)
+        {
+            mNillLink = (mIndexBytes == 4) ? (u32)NILL_IDX : (((u32)1 << (mIndexBytes * 8)) - 1);
+        }
 
         void initialize(void* object_array, u32 size_of_object, u32 object_alignment, u32 size);
         void initialize(alloc_t* allocator, u32 size_of_object, u32 object_alignment, u32 size);
 
+        xoccupancy_t track_occupancy();
+
+        virtual void init();
+        virtual void clear();
+
         XCORE_CLASS_PLACEMENT_NEW_DELETE
 
     protected:
@@ -23,8 +34,32 @@ namespace xcore
 
         void init_freelist();
 
-        virtual void init();
-        virtual void clear();
+        // The free list links are stored in the free objects with a width of 2, 3 or 4 bytes
+        inline u32 read_link(xbyte const* object) const
+        {
+            switch (mIndexBytes)
+            {
+                case 2: return *(u16 const*)object;
+                case 3: return (u32)object[0] | ((u32)object[1] << 8) | ((u32)object[2] << 16);
+                default: return *(u32 const*)object;
+            }
+        }
+
+        inline void write_link(xbyte* object, u32 link) const
+        {
+            switch (mIndexBytes)
+            {
+                case 2: *(u16*)object = (u16)link; break;
+                case 3:
+                    object[0] = (xbyte)(link);
+                    object[1] = (xbyte)(link >> 8);
+                    object[2] = (xbyte)(link >> 16);
+                    break;
+                default: *(u32*)object = link; break;
+            }
+        }
+
+        void setup(u32 size_of_object, u32 object_alignment, u32 size);
 
         virtual u32   v_size() const { return mSizeOfObject; }
         virtual void* v_allocate();
@@ -36,7 +71,7 @@ namespace xcore
 
     private:
         alloc_t* mAllocator;
-        u32*     mFreeObjectList;
+        xbyte*   mFreeObjectList;
         u32      mAllocCount;
         alloc_t* mObjectArrayAllocator;
         u32      mObjectArraySize;
@@ -44,6 +79,9 @@ namespace xcore
         xbyte*   mObjectArrayEnd;
         u32      mSizeOfObject;
         u32      mAlignOfObject;
+        u64*     mOccupancy;
+        u32      mIndexBytes;
+        u32      mNillLink;
     };
 
     fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, alloc_t* object_array_allocator, u32 size_of_object, u32 object_alignment, u32 size)
@@ -51,6 +89,7 @@ namespace xcore
         void*                 mem             = allocator->allocate(sizeof(x_fsadexed_allocator), 4);
         x_fsadexed_allocator* array_allocator = new (mem) x_fsadexed_allocator(allocator);
         array_allocator->initialize(object_array_allocator, size_of_object, object_alignment, size);
+        array_allocator->init();
         return array_allocator;
     }
 
@@ -59,44 +98,105 @@ namespace xcore
         void*                 mem             = allocator->allocate(sizeof(x_fsadexed_allocator), 4);
         x_fsadexed_allocator* array_allocator = new (mem) x_fsadexed_allocator(allocator);
         array_allocator->initialize(object_array, size_of_object, object_alignment, size);
+        array_allocator->init();
+        return array_allocator;
+    }
+
+    fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, alloc_t* object_array_allocator, u32 size_of_object, u32 object_alignment, u32 size, xoccupancy_t& outOccupancy)
+    {
+        void*                 mem             = allocator->allocate(sizeof(x_fsadexed_allocator), 4);
+        x_fsadexed_allocator* array_allocator = new (mem) x_fsadexed_allocator(allocator);
+        array_allocator->initialize(object_array_allocator, size_of_object, object_alignment, size);
+        array_allocator->init();
+        outOccupancy = array_allocator->track_occupancy();
+        return array_allocator;
+    }
+
+    fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, void* object_array, u32 size_of_object, u32 object_alignment, u32 size, xoccupancy_t& outOccupancy)
+    {
+        void*                 mem             = allocator->allocate(sizeof(x_fsadexed_allocator), 4);
+        x_fsadexed_allocator* array_allocator = new (mem) x_fsadexed_allocator(allocator);
+        array_allocator->initialize(object_array, size_of_object, object_alignment, size);
+        array_allocator->init();
+        outOccupancy = array_allocator->track_occupancy();
+        return array_allocator;
+    }
+
+    fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, alloc_t* object_array_allocator, u32 size_of_object, u32 object_alignment, u32 size, EIndexWidth index_width)
+    {
+        void*                 mem             = allocator->allocate(sizeof(x_fsadexed_allocator), 4);
+        x_fsadexed_allocator* array_allocator = new (mem) x_fsadexed_allocator(allocator, index_width);
+        array_allocator->initialize(object_array_allocator, size_of_object, object_alignment, size);
+        array_allocator->init();
+        return array_allocator;
+    }
+
+    fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, void* object_array, u32 size_of_object, u32 object_alignment, u32 size, EIndexWidth index_width)
+    {
+        void*                 mem             = allocator->allocate(sizeof(x_fsadexed_allocator), 4);
+        x_fsadexed_allocator* array_allocator = new (mem) x_fsadexed_allocator(allocator, index_width);
+        array_allocator->initialize(object_array, size_of_object, object_alignment, size);
+        array_allocator->init();
         return array_allocator;
     }
 
     void x_fsadexed_allocator::init_freelist()
     {
-        u32* object_array = (u32*)mObjectArray;
+        xbyte* object = mObjectArray;
         for (u32 i = 1; i < mObjectArraySize; ++i)
         {
-            *object_array = i;
-            object_array += mSizeOfObject / 4;
+            write_link(object, i);
+            object += mSizeOfObject;
+        }
+        write_link(object, mNillLink);
+        mFreeObjectList = mObjectArray;
+
+        if (mOccupancy != NULL)
+            x_memset(mOccupancy, 0, xoccupancy_t::num_words(mObjectArraySize) * sizeof(u64));
+    }
+
+    xoccupancy_t x_fsadexed_allocator::track_occupancy()
+    {
+        ASSERT(mAllocCount == 0);
+        if (mOccupancy == NULL)
+        {
+            mOccupancy = (u64*)mAllocator->allocate(xoccupancy_t::num_words(mObjectArraySize) * sizeof(u64), sizeof(u64));
+            x_memset(mOccupancy, 0, xoccupancy_t::num_words(mObjectArraySize) * sizeof(u64));
         }
-        *object_array   = NILL_IDX;
-        mFreeObjectList = (u32*)mObjectArray;
+        return xoccupancy_t(mOccupancy, mObjectArraySize);
+    }
+
+    void x_fsadexed_allocator::setup(u32 size_of_object, u32 object_alignment, u32 size)
+    {
+        // The index width limits the number of objects (the largest value is the NILL link)
+        ASSERT(size > 0 && (size - 1) < mNillLink);
+
+        // An object has to be able to hold a free list link, a 3 byte link is accessed per byte
+        u32 const link_alignment = (mIndexBytes == 3) ? 1 : mIndexBytes;
+        size_of_object           = size_of_object < mIndexBytes ? mIndexBytes : size_of_object;
+
+        mFreeObjectList  = NULL;
+        mAllocCount      = 0;
+        mObjectArraySize = size;
+        mAlignOfObject   = xalignUp(object_alignment == 0 ? 1 : object_alignment, link_alignment);
+        mSizeOfObject    = xalignUp(size_of_object, mAlignOfObject);
     }
 
     void x_fsadexed_allocator::initialize(void* object_array, u32 size_of_object, u32 object_alignment, u32 size)
     {
-        object_alignment = xalignUp(object_alignment, (u32)4);
+        setup(size_of_object, object_alignment, size);
 
-        mFreeObjectList       = NULL;
-        mAllocCount           = 0;
         mObjectArrayAllocator = NULL;
-        mObjectArraySize      = size;
-        mSizeOfObject         = xalignUp(size_of_object, object_alignment);
         mObjectArray          = (xbyte*)object_array;
         mObjectArrayEnd       = mObjectArray + (mObjectArraySize * mSizeOfObject);
     }
 
     void x_fsadexed_allocator::initialize(alloc_t* allocator, u32 size_of_object, u32 object_alignment, u32 size)
     {
-        mFreeObjectList       = NULL;
-        mAllocCount           = 0;
-        mObjectArray          = NULL;
-        mObjectArrayAllocator = allocator;
-        mObjectArraySize      = size;
+        setup(size_of_object, object_alignment, size);
 
-        mAlignOfObject = xalignUp(object_alignment, (u32)4);
-        mSizeOfObject  = xalignUp(size_of_object, mAlignOfObject);
+        mObjectArrayAllocator = allocator;
+        mObjectArray          = NULL;
     }
 
     void x_fsadexed_allocator::init()
@@ -139,12 +239,15 @@ namespace xcore
         u32 idx = (u32)((uptr)mFreeObjectList - (uptr)mObjectArray) / mSizeOfObject;
         p       = (void*)mFreeObjectList;
 
-        u32 next_object = *mFreeObjectList;
-        if (next_object != NILL_IDX)
-            mFreeObjectList = (u32*)((uptr)mObjectArray + (next_object * mSizeOfObject));
+        u32 next_object = read_link(mFreeObjectList);
+        if (next_object != mNillLink)
+            mFreeObjectList = mObjectArray + (next_object * mSizeOfObject);
         else
             mFreeObjectList = NULL;
 
+        if (mOccupancy != NULL)
+            xoccupancy_t::set_live(mOccupancy, idx);
+
         ++mAllocCount;
         return p;
     }
@@ -154,9 +257,11 @@ namespace xcore
         u32 idx = ptr2idx(ptr);
         if (idx < mObjectArraySize)
         {
-            u32* free_object = (u32*)(mObjectArray + (mSizeOfObject * idx));
-            *free_object     = ptr2idx(mFreeObjectList);
-            mFreeObjectList  = free_object;
+            xbyte* free_object = mObjectArray + (mSizeOfObject * idx);
+            write_link(free_object, mFreeObjectList != NULL ? ptr2idx(mFreeObjectList) : mNillLink);
+            mFreeObjectList = free_object;
+            if (mOccupancy != NULL)
+                xoccupancy_t::set_free(mOccupancy, idx);
             --mAllocCount;
         }
         return mSizeOfObject;
@@ -188,7 +293,13 @@ namespace xcore
     void x_fsadexed_allocator::v_release()
     {
         clear();
+        if (mOccupancy != NULL)
+        {
+            mAllocator->deallocate(mOccupancy);
+            mOccupancy = NULL;
+        }
+        alloc_t* allocator = mAllocator;
         this->~x_fsadexed_allocator();
-        mAllocator->deallocate(this);
+        allocator->deallocate(this);
     }
 } // namespace xcore
@@ -0,0 +1,428 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+
+#include "xallocator/x_page_provider.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace xcore
+{
+    // ---------------------------------------------------------------------------------------------
+    // Static buffer
+    // ---------------------------------------------------------------------------------------------
+    class x_page_provider_static : public page_provider_t
+    {
+    public:
+        x_page_provider_static(alloc_t* allocator, xbyte* mem, u64 memsize, u32 page_size)
+            : mAllocator(allocator)
+            , mBegin((xbyte*)xalignUp((uptr)mem, (uptr)page_size))
+            , mCursor(mBegin)
+            , mEnd((xbyte*)mem + memsize)
+            , mPageSize(page_size)
+        {
+            ASSERT(page_size != 0 && (page_size & (page_size - 1)) == 0);
+        }
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual u32 v_page_size() const { return mPageSize; }
+
+        virtual void* v_reserve(u64 size, u64 alignment)
+        {
+            alignment = alignment < mPageSize ? mPageSize : alignment;
+            xbyte* ptr = (xbyte*)xalignUp((uptr)mCursor, (uptr)alignment);
+            if (ptr > mEnd || size > (u64)(mEnd - ptr))
+                return NULL;
+            mCursor = ptr + size;
+            return ptr;
+        }
+
+        virtual bool v_commit(void*, u64) { return true; }
+        virtual void v_decommit(void*, u64) {}
+
+        virtual void v_release(void* addr, u64 size)
+        {
+            if (((xbyte*)addr + size) == mCursor)
+                mCursor = (xbyte*)addr;
+        }
+
+        virtual void v_destroy()
+        {
+            alloc_t* allocator = mAllocator;
+            this->~x_page_provider_static();
+            allocator->deallocate(this);
+        }
+
+    private:
+        alloc_t* mAllocator;
+        xbyte*   mBegin;
+        xbyte*   mCursor;
+        xbyte*   mEnd;
+        u32      mPageSize;
+    };
+
+    page_provider_t* gCreateStaticPageProvider(alloc_t* allocator, void* mem, u64 memsize, u32 page_size)
+    {
+        void* obj = allocator->allocate(sizeof(x_page_provider_static), sizeof(void*));
+        return new (obj) x_page_provider_static(allocator, (xbyte*)mem, memsize, page_size);
+    }
+
+#if defined(__linux__)
+    // ---------------------------------------------------------------------------------------------
+    // Virtual memory; anonymous, hugetlb or memfd backed
+    //
+    // reserve() maps inaccessible address space, for an alignment larger than a page it maps more
+    // and unmaps the head and tail. commit() makes the pages accessible, decommit() drops them.
+    //
+    // The memfd variant gives every reservation its own range of the file, taken from a cursor at the
+    // end of the file or from the range of a released reservation. A decommit punches a hole in the file.
+    // ---------------------------------------------------------------------------------------------
+    class x_page_provider_vm : public page_provider_t
+    {
+    public:
+        enum EBacking
+        {
+            BACKING_ANONYMOUS,
+            BACKING_HUGETLB,
+            BACKING_MEMFD,
+        };
+
+        x_page_provider_vm(alloc_t* allocator, EBacking backing, u32 flags, u32 page_size, int fd)
+            : mAllocator(allocator)
+            , mBacking(backing)
+            , mFlags(flags)
+            , mPageSize(page_size)
+            , mFd(fd)
+            , mFileSize(0)
+            , mRanges(NULL)
+            , mFreeRanges(NULL)
+        {
+        }
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        virtual u32 v_page_size() const { return mPageSize; }
+
+        virtual void* v_reserve(u64 size, u64 alignment)
+        {
+            alignment = alignment < mPageSize ? mPageSize : alignment;
+            size      = xalignUp(size, (u64)mPageSize);
+
+            int map_flags = MAP_PRIVATE | MAP_ANONYMOUS;
+            if (mBacking == BACKING_HUGETLB)
+                map_flags |= MAP_HUGETLB;
+            else
+                map_flags |= MAP_NORESERVE;
+
+            u64 const total = size + alignment - mPageSize;
+            void*     mem   = mmap(NULL, (size_t)total, PROT_NONE, map_flags, -1, 0);
+            if (mem == MAP_FAILED)
+                return NULL;
+
+            xbyte* const begin = (xbyte*)mem;
+            xbyte* const ptr   = (xbyte*)xalignUp((uptr)begin, (uptr)alignment);
+            xbyte* const end   = begin + total;
+            if (ptr != begin)
+                munmap(begin, (size_t)(ptr - begin));
+            if ((ptr + size) != end)
+                munmap(ptr + size, (size_t)(end - (ptr + size)));
+
+            if (mBacking == BACKING_MEMFD && !add_range(ptr, size))
+            {
+                munmap(ptr, (size_t)size);
+                return NULL;
+            }
+
+#if defined(MADV_HUGEPAGE)
+            if (mBacking == BACKING_ANONYMOUS && (mFlags & PAGES_HUGE_HINT) != 0)
+                madvise(ptr, (size_t)size, MADV_HUGEPAGE);
+#endif
+            return ptr;
+        }
+
+        virtual bool v_commit(void* addr, u64 size)
+        {
+            if (mBacking == BACKING_MEMFD)
+            {
+                void* mem = mmap(addr, (size_t)size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED, mFd, (off_t)file_offset(addr));
+                if (mem == MAP_FAILED)
+                    return false;
+            }
+            else if (mprotect(addr, (size_t)size, PROT_READ | PROT_WRITE) != 0)
+            {
+                return false;
+            }
+
+            if ((mFlags & PAGES_PREFAULT) != 0)
+                prefault((xbyte*)addr, size);
+            return true;
+        }
+
+        virtual void v_decommit(void* addr, u64 size)
+        {
+            if (mBacking == BACKING_MEMFD)
+            {
+                mmap(addr, (size_t)size, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED, -1, 0);
+                fallocate(mFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)file_offset(addr), (off_t)size);
+            }
+            else
+            {
+                madvise(addr, (size_t)size, MADV_DONTNEED);
+                mprotect(addr, (size_t)size, PROT_NONE);
+            }
+        }
+
+        virtual void v_release(void* addr, u64 size)
+        {
+            size = xalignUp(size, (u64)mPageSize);
+            munmap(addr, (size_t)size);
+            if (mBacking == BACKING_MEMFD)
+                remove_range(addr);
+        }
+
+        virtual void v_destroy()
+        {
+            ASSERT(mRanges == NULL);
+            while (mFreeRanges != NULL)
+            {
+                range_t* range = mFreeRanges;
+                mFreeRanges    = range->mNext;
+                mAllocator->deallocate(range);
+            }
+            if (mFd >= 0)
+                close(mFd);
+            alloc_t* allocator = mAllocator;
+            this->~x_page_provider_vm();
+            allocator->deallocate(this);
+        }
+
+        void prefault(xbyte* addr, u64 size)
+        {
+#if defined(MADV_POPULATE_WRITE)
+            if (madvise(addr, (size_t)size, MADV_POPULATE_WRITE) == 0)
+                return;
+#endif
+            // Touch every page, a write of the byte that is already there
+            for (u64 offset = 0; offset < size; offset += mPageSize)
+                *(xbyte volatile*)(addr + offset) = *(xbyte volatile*)(addr + offset);
+        }
+
+        // Part of the memory file that backs one reservation
+        struct range_t
+        {
+            xbyte*   mBase;
+            u64      mOffset;
+            u64      mSize;
+            range_t* mNext;
+        };
+
+        bool add_range(xbyte* base, u64 size)
+        {
+            // Reuse (part of) the range of a released reservation, otherwise grow the file
+            range_t* range = NULL;
+            for (range_t** link = &mFreeRanges; *link != NULL; link = &(*link)->mNext)
+            {
+                if ((*link)->mSize < size)
+                    continue;
+                range_t* const free_range = *link;
+                if (free_range->mSize == size)
+                {
+                    range = free_range;
+                    *link = range->mNext;
+                }
+                else
+                {
+                    range = (range_t*)mAllocator->allocate(sizeof(range_t), sizeof(void*));
+                    if (range == NULL)
+                        return false;
+                    range->mOffset = free_range->mOffset;
+                    free_range->mOffset += size;
+                    free_range->mSize -= size;
+                }
+                break;
+            }
+
+            if (range == NULL)
+            {
+                range = (range_t*)mAllocator->allocate(sizeof(range_t), sizeof(void*));
+                if (range == NULL)
+                    return false;
+                if (ftruncate(mFd, (off_t)(mFileSize + size)) != 0)
+                {
+                    mAllocator->deallocate(range);
+                    return false;
+                }
+                range->mOffset = mFileSize;
+                mFileSize += size;
+            }
+
+            range->mBase = base;
+            range->mSize = size;
+            range->mNext = mRanges;
+            mRanges      = range;
+            return true;
+        }
+
+        void remove_range(void* base)
+        {
+            range_t** link = &mRanges;
+            while (*link != NULL && (*link)->mBase != (xbyte*)base)
+                link = &(*link)->mNext;
+            ASSERT(*link != NULL);
+            if (*link == NULL)
+                return;
+
+            range_t* const range = *link;
+            *link                = range->mNext;
+            fallocate(mFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t)range->mOffset, (off_t)range->mSize);
+            range->mBase = NULL;
+            range->mNext = mFreeRanges;
+            mFreeRanges  = range;
+        }
+
+        u64 file_offset(void* addr) const
+        {
+            for (range_t const* range = mRanges; range != NULL; range = range->mNext)
+            {
+                if ((xbyte*)addr >= range->mBase && (xbyte*)addr < (range->mBase + range->mSize))
+                    return range->mOffset + (u64)((xbyte*)addr - range->mBase);
+            }
+            ASSERT(false);
+            return 0;
+        }
+
+    private:
+        alloc_t* mAllocator;
+        EBacking mBacking;
+        u32      mFlags;
+        u32      mPageSize;
+        int      mFd;
+        u64      mFileSize;   // Cursor at the end of the memory file
+        range_t* mRanges;     // Reservations, memfd only
+        range_t* mFreeRanges; // File ranges of released reservations, reused by later reservations
+    };
+
+    static page_provider_t* create_vm_provider(alloc_t* allocator, x_page_provider_vm::EBacking backing, u32 flags, u32 page_size, int fd)
+    {
+        void* obj = allocator->allocate(sizeof(x_page_provider_vm), sizeof(void*));
+        return new (obj) x_page_provider_vm(allocator, backing, flags, page_size, fd);
+    }
+
+    page_provider_t* gCreateVirtualPageProvider(alloc_t* allocator, u32 flags)
+    {
+        return create_vm_provider(allocator, x_page_provider_vm::BACKING_ANONYMOUS, flags, (u32)sysconf(_SC_PAGESIZE), -1);
+    }
+
+    page_provider_t* gCreateHugePageProvider(alloc_t* allocator, u32 flags)
+    {
+        // The default huge page size on x86-64 and arm64
+        return create_vm_provider(allocator, x_page_provider_vm::BACKING_HUGETLB, flags, 2 * 1024 * 1024, -1);
+    }
+
+    page_provider_t* gCreateMemfdPageProvider(alloc_t* allocator, u32 flags)
+    {
+        int const fd = (int)syscall(SYS_memfd_create, "xpageprovider", 0);
+        if (fd < 0)
+            return NULL;
+        return create_vm_provider(allocator, x_page_provider_vm::BACKING_MEMFD, flags, (u32)sysconf(_SC_PAGESIZE), fd);
+    }
+
+#else
+    page_provider_t* gCreateVirtualPageProvider(alloc_t*, u32) { return NULL; }
+    page_provider_t* gCreateHugePageProvider(alloc_t*, u32) { return NULL; }
+    page_provider_t* gCreateMemfdPageProvider(alloc_t*, u32) { return NULL; }
+#endif
+
+    // ---------------------------------------------------------------------------------------------
+    // Page allocator
+    //
+    // Every allocation has its own reservation, the page before the returned pointer holds a header
+    // with the reservation. An alignment larger than a page reserves (alignment - page) bytes more,
+    // that part of the address space is never committed.
+    // ---------------------------------------------------------------------------------------------
+    class x_allocator_page : public alloc_t
+    {
+    public:
+        x_allocator_page(alloc_t* allocator, page_provider_t* provider)
+            : mAllocator(allocator)
+            , mProvider(provider)
+            , mPageSize(provider->page_size())
+        {
+        }
+
+        virtual const char* name() const { return TARGET_FULL_DESCR_STR "[Allocator, Type=Pages]"; }
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        struct header_t
+        {
+            xbyte* mBase;
+            u64    mReserved;
+            u64    mSize;
+        };
+
+        virtual void* v_allocate(u32 size, u32 alignment)
+        {
+            u64 const lead      = alignment < mPageSize ? (u64)mPageSize : (u64)alignment;
+            u64 const committed = xalignUp((u64)size, (u64)mPageSize);
+            u64 const reserved  = lead + committed;
+
+            xbyte* base = (xbyte*)mProvider->reserve(reserved, lead);
+            if (base == NULL)
+                return NULL;
+
+            xbyte* ptr = base + lead;
+            if (!mProvider->commit(ptr - mPageSize, committed + mPageSize))
+            {
+                mProvider->release(base, reserved);
+                return NULL;
+            }
+
+            header_t* header  = (header_t*)(ptr - mPageSize);
+            header->mBase     = base;
+            header->mReserved = reserved;
+            header->mSize     = committed;
+            return ptr;
+        }
+
+        virtual u32 v_deallocate(void* ptr)
+        {
+            if (ptr == NULL)
+                return 0;
+            header_t const* header = (header_t const*)((xbyte*)ptr - mPageSize);
+            xbyte* const    base   = header->mBase;
+            u64 const       size   = header->mSize;
+            mProvider->release(base, header->mReserved);
+            return (u32)size;
+        }
+
+        virtual void v_release()
+        {
+            alloc_t* allocator = mAllocator;
+            this->~x_allocator_page();
+            allocator->deallocate(this);
+        }
+
+    private:
+        alloc_t*         mAllocator;
+        page_provider_t* mProvider;
+        u32              mPageSize;
+    };
+
+    alloc_t* gCreatePageAllocator(alloc_t* allocator, page_provider_t* provider)
+    {
+        void* mem = allocator->allocate(sizeof(x_allocator_page), sizeof(void*));
+        return new (mem) x_allocator_page(allocator, provider);
+    }
+
+}; // namespace xcore
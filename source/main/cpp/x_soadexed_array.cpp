@@ -0,0 +1,204 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+#include "xbase/x_memory.h"
+
+#include "xallocator/x_soadexed_array.h"
+#include "xallocator/private/x_hibitset.h"
+
+namespace xcore
+{
+    class x_soadexed_allocator : public soadexed_t
+    {
+    public:
+        x_soadexed_allocator(alloc_t* allocator, alloc_t* column_allocator);
+
+        bool initialize(u32 const* field_sizes, u32 num_fields, u32 size);
+
+        virtual u32  iallocate();
+        virtual void ideallocate(u32 index);
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        enum
+        {
+            NILL_IDX = 0xffffffff
+        };
+
+        virtual u32   v_size() const { return mFieldSizes[0]; }
+        virtual void* v_allocate();
+        virtual u32   v_deallocate(void* p);
+        virtual void* v_idx2ptr(u32 idx) const;
+        virtual u32   v_ptr2idx(void* p) const;
+
+        virtual void v_release();
+
+    private:
+        alloc_t*    mAllocator;
+        alloc_t*    mColumnAllocator;
+        xbyte*      mColumnMemory;
+        u64*        mFreeSetWords;
+        xhibitset_t mFreeSet;
+        u32         mUsed;
+    };
+
+    soadexed_t* gCreateSoaIdxAllocator(alloc_t* allocator, alloc_t* column_allocator, u32 const* field_sizes, u32 num_fields, u32 size)
+    {
+        void* mem = allocator->allocate(sizeof(x_soadexed_allocator), sizeof(void*));
+        if (mem == NULL)
+            return NULL;
+
+        x_soadexed_allocator* soa_allocator = new (mem) x_soadexed_allocator(allocator, column_allocator);
+        if (!soa_allocator->initialize(field_sizes, num_fields, size))
+        {
+            soa_allocator->~x_soadexed_allocator();
+            allocator->deallocate(mem);
+            return NULL;
+        }
+        return soa_allocator;
+    }
+
+    x_soadexed_allocator::x_soadexed_allocator(alloc_t* allocator, alloc_t* column_allocator) : mAllocator(allocator), mColumnAllocator(column_allocator), mColumnMemory(NULL), mFreeSetWords(NULL), mUsed(0) {}
+
+    bool x_soadexed_allocator::initialize(u32 const* field_sizes, u32 num_fields, u32 size)
+    {
+        ASSERT(num_fields > 0 && num_fields <= MAX_COLUMNS);
+        ASSERT(size > 0);
+
+        mNumColumns = num_fields;
+        mCapacity   = size;
+        mLiveEnd    = 0;
+        mUsed       = 0;
+
+        // All columns live in one block, each one starting on a COLUMN_ALIGNMENT boundary, the size
+        // is summed in 64 bits so that a block that does not fit in a u32 is rejected instead of wrapped
+        u64 total_size = 0;
+        for (u32 c = 0; c < MAX_COLUMNS; ++c)
+        {
+            mFieldSizes[c] = (c < num_fields) ? field_sizes[c] : 0;
+            ASSERT(c >= num_fields || mFieldSizes[c] > 0);
+            total_size += ((u64)mFieldSizes[c] * size + (COLUMN_ALIGNMENT - 1)) & ~(u64)(COLUMN_ALIGNMENT - 1);
+        }
+        if (total_size > 0xffffffff)
+            return false;
+
+        mColumnMemory = (xbyte*)mColumnAllocator->allocate((u32)total_size, COLUMN_ALIGNMENT);
+        if (mColumnMemory == NULL)
+            return false;
+
+        xbyte* column = mColumnMemory;
+        for (u32 c = 0; c < MAX_COLUMNS; ++c)
+        {
+            mColumns[c] = (c < num_fields) ? column : NULL;
+            column += xalignUp(mFieldSizes[c] * size, (u32)COLUMN_ALIGNMENT);
+        }
+
+        u32 const occupancy_words = xoccupancy_t::num_words(size);
+        mOccupancy                = (u64*)mAllocator->allocate(occupancy_words * sizeof(u64), sizeof(u64));
+        mFreeSetWords             = (u64*)mAllocator->allocate(xhibitset_t::words_for(size) * sizeof(u64), sizeof(u64));
+        if (mOccupancy == NULL || mFreeSetWords == NULL)
+        {
+            if (mOccupancy != NULL)
+                mAllocator->deallocate(mOccupancy);
+            if (mFreeSetWords != NULL)
+                mAllocator->deallocate(mFreeSetWords);
+            mColumnAllocator->deallocate(mColumnMemory);
+            mColumnMemory = NULL;
+            mOccupancy    = NULL;
+            mFreeSetWords = NULL;
+            return false;
+        }
+
+        x_memset(mOccupancy, 0, occupancy_words * sizeof(u64));
+        mFreeSet.init(mFreeSetWords, size, true);
+        return true;
+    }
+
+    u32 x_soadexed_allocator::iallocate()
+    {
+        s32 const idx = mFreeSet.find();
+        if (idx < 0)
+            return NILL_IDX;
+
+        mFreeSet.clr(idx);
+        xoccupancy_t::set_live(mOccupancy, idx);
+        if ((u32)idx >= mLiveEnd)
+            mLiveEnd = idx + 1;
+        ++mUsed;
+        return idx;
+    }
+
+    void x_soadexed_allocator::ideallocate(u32 index)
+    {
+        ASSERT(index < mCapacity && occupancy().is_live(index));
+
+        xoccupancy_t::set_free(mOccupancy, index);
+        mFreeSet.set(index);
+        --mUsed;
+
+        // Pull the live end back to just after the last live slot
+        if ((index + 1) == mLiveEnd)
+        {
+            mLiveEnd = 0;
+            for (s32 w = (s32)(index >> 6); w >= 0; --w)
+            {
+                if (mOccupancy[w] != 0)
+                {
+                    mLiveEnd = (w << 6) + xoccupancy_t::find_last_bit(mOccupancy[w]) + 1;
+                    break;
+                }
+            }
+        }
+    }
+
+    void* x_soadexed_allocator::v_allocate()
+    {
+        u32 const idx = iallocate();
+        if (idx == NILL_IDX)
+            return NULL;
+        return field(idx, 0);
+    }
+
+    u32 x_soadexed_allocator::v_deallocate(void* p)
+    {
+        u32 const idx = v_ptr2idx(p);
+        if (idx == NILL_IDX)
+            return 0;
+        ideallocate(idx);
+        return mFieldSizes[0];
+    }
+
+    void* x_soadexed_allocator::v_idx2ptr(u32 idx) const
+    {
+        if (idx == NILL_IDX)
+            return NULL;
+        ASSERT(idx < mCapacity);
+        return field(idx, 0);
+    }
+
+    u32 x_soadexed_allocator::v_ptr2idx(void* p) const
+    {
+        xbyte const* column = mColumns[0];
+        if ((xbyte*)p >= column && (xbyte*)p < (column + (mCapacity * mFieldSizes[0])))
+            return (u32)((xbyte*)p - column) / mFieldSizes[0];
+        return NILL_IDX;
+    }
+
+    void x_soadexed_allocator::v_release()
+    {
+        ASSERT(mUsed == 0);
+        mColumnAllocator->deallocate(mColumnMemory);
+        mAllocator->deallocate(mOccupancy);
+        mAllocator->deallocate(mFreeSetWords);
+        mColumnMemory = NULL;
+        mOccupancy    = NULL;
+        mFreeSetWords = NULL;
+
+        alloc_t* allocator = mAllocator;
+        this->~x_soadexed_allocator();
+        allocator->deallocate(this);
+    }
+
+} // namespace xcore
@@ -0,0 +1,100 @@
+#ifndef __X_ALLOCATOR_ATOMIC_H__
+#define __X_ALLOCATOR_ATOMIC_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace xcore
+{
+    // Minimal set of atomic operations used by the concurrent allocators.
+    // Read-modify-write operations are sequentially consistent (full barrier), loads have
+    // acquire and stores have release semantics.
+    namespace xatomic
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        template <typename T> inline T    load(T const volatile* v) { return __atomic_load_n(v, __ATOMIC_ACQUIRE); }
+        template <typename T> inline T    load_relaxed(T const volatile* v) { return __atomic_load_n(v, __ATOMIC_RELAXED); }
+        template <typename T> inline void store(T volatile* v, T value) { __atomic_store_n(v, value, __ATOMIC_RELEASE); }
+        template <typename T> inline T    fetch_add(T volatile* v, T value) { return __atomic_fetch_add(v, value, __ATOMIC_SEQ_CST); }
+        template <typename T> inline T    fetch_or(T volatile* v, T value) { return __atomic_fetch_or(v, value, __ATOMIC_SEQ_CST); }
+        template <typename T> inline T    fetch_and(T volatile* v, T value) { return __atomic_fetch_and(v, value, __ATOMIC_SEQ_CST); }
+        template <typename T> inline T    exchange(T volatile* v, T value) { return __atomic_exchange_n(v, value, __ATOMIC_SEQ_CST); }
+
+        // On failure @expected is updated with the current value
+        template <typename T> inline bool cas(T volatile* v, T& expected, T desired) { return __atomic_compare_exchange_n(v, &expected, desired, false, __ATOMIC_SEQ_CST, __ATOMIC_ACQUIRE); }
+
+        inline void pause()
+        {
+#if defined(__i386__) || defined(__x86_64__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            __asm__ __volatile__("yield");
+#endif
+        }
+#elif defined(_MSC_VER)
+        // On x86/x64 aligned loads and stores already have acquire/release semantics, only the
+        // compiler has to be prevented from reordering.
+        template <typename T> inline T load(T const volatile* v)
+        {
+            T value = *v;
+            _ReadWriteBarrier();
+            return value;
+        }
+        template <typename T> inline T    load_relaxed(T const volatile* v) { return *v; }
+        template <typename T> inline void store(T volatile* v, T value)
+        {
+            _ReadWriteBarrier();
+            *v = value;
+        }
+
+        inline u32 fetch_add(u32 volatile* v, u32 value) { return (u32)_InterlockedExchangeAdd((long volatile*)v, (long)value); }
+        inline s32 fetch_add(s32 volatile* v, s32 value) { return (s32)_InterlockedExchangeAdd((long volatile*)v, (long)value); }
+        inline u64 fetch_add(u64 volatile* v, u64 value) { return (u64)_InterlockedExchangeAdd64((__int64 volatile*)v, (__int64)value); }
+        inline s64 fetch_add(s64 volatile* v, s64 value) { return (s64)_InterlockedExchangeAdd64((__int64 volatile*)v, (__int64)value); }
+        inline u64 fetch_or(u64 volatile* v, u64 value) { return (u64)_InterlockedOr64((__int64 volatile*)v, (__int64)value); }
+        inline u64 fetch_and(u64 volatile* v, u64 value) { return (u64)_InterlockedAnd64((__int64 volatile*)v, (__int64)value); }
+        template <typename T> inline T* exchange(T* volatile* v, T* value) { return (T*)_InterlockedExchangePointer((void* volatile*)v, (void*)value); }
+
+        inline bool cas(u32 volatile* v, u32& expected, u32 desired)
+        {
+            u32 const prev = (u32)_InterlockedCompareExchange((long volatile*)v, (long)desired, (long)expected);
+            bool const ok  = (prev == expected);
+            expected       = prev;
+            return ok;
+        }
+        inline bool cas(u64 volatile* v, u64& expected, u64 desired)
+        {
+            u64 const  prev = (u64)_InterlockedCompareExchange64((__int64 volatile*)v, (__int64)desired, (__int64)expected);
+            bool const ok   = (prev == expected);
+            expected        = prev;
+            return ok;
+        }
+        template <typename T> inline bool cas(T* volatile* v, T*& expected, T* desired)
+        {
+            T* const   prev = (T*)_InterlockedCompareExchangePointer((void* volatile*)v, (void*)desired, (void*)expected);
+            bool const ok   = (prev == expected);
+            expected        = prev;
+            return ok;
+        }
+
+        inline void pause()
+        {
+#if defined(_M_ARM64)
+            __yield();
+#else
+            _mm_pause();
+#endif
+        }
+#else
+#error "xatomic: unsupported compiler"
+#endif
+    } // namespace xatomic
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_ATOMIC_H__
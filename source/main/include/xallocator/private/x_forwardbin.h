@@ -31,9 +31,13 @@ namespace xcore
 			void				reset();
 
 			xbyte*				allocate(u32 size, u32 alignment);
+			void				commit(void* p, u32 size);
 			u32					get_size(void* p) const;
 			u32  				deallocate(void* p);
 
+			inline u32			num_allocations() const					{ return mNumAllocations; }
+			inline bool			owns(void const* p) const				{ return (xbyte const*)p >= mMemBegin && (xbyte const*)p < mMemEnd; }
+
 		private:
 			xbyte*				mMemBegin;
 			xbyte*				mMemEnd;
@@ -5,6 +5,8 @@
 #pragma once 
 #endif
 
+#include "xallocator/private/x_hibitset.h"
+
 namespace xcore
 {
 	struct xfreelist_t
@@ -18,6 +20,16 @@ namespace xcore
 		void				init_list();
 		void				release();
 
+		// Optional occupancy bitmap, @bits must hold (size() + 63) / 64 words, NULL disables tracking
+		void				init_occupancy(u64* bits);
+		inline u64*			occupancy() const						{ return mOccupancy; }
+
+		// Optional lowest-index-first policy, alloc() then always returns the lowest free element which
+		// keeps the live set packed at the front of the array. @words must hold lowest_first_words(size()).
+		void				init_lowest_first(u64* words);
+		static u32			lowest_first_words(s32 size)			{ return xhibitset_t::words_for((u32)size); }
+		inline bool			is_lowest_first() const					{ return mFreeSet.valid(); }
+
 		inline bool			valid() const							{ return (mElementArray!=nullptr); }
 		inline s32			size() const							{ return mSize; }
 		inline s32			used() const							{ return mUsed; }
@@ -38,7 +50,7 @@ namespace xcore
 			if (element == NULL)
 				return NULL_INDEX;
 			s32 idx = ((s32)((xbyte const*)element - (xbyte const*)mElementArray)) / (s32)mElemSize;
-			if (idx >= 0 && idx < mSize)
+			if (idx >= 0 && idx < (s32)mSize)
 				return idx;
 			return NULL_INDEX;
 		}
@@ -55,6 +67,9 @@ namespace xcore
 		u32 				mSize;
 		xbyte*				mElementArray;
 		xitem_t*			mFreeList;
+		u64*				mOccupancy;
+		u64*				mFreeSetWords;
+		xhibitset_t			mFreeSet;
 	};
 
 };
@@ -0,0 +1,118 @@
+#ifndef __X_ALLOCATOR_HIBITSET_H__
+#define __X_ALLOCATOR_HIBITSET_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xallocator/x_occupancy.h"
+
+namespace xcore
+{
+    // Hierarchical bitset, every level holds one u64 per 64 children where a bit is set when
+    // the child (word) below it has at least one bit set. The lowest set bit is found in
+    // O(log64 N) by doing one bit-scan per level, starting at the single top word.
+    //
+    // Levels are stored top-down in one array of words_for(N) words, 6 levels cover any u32 number of bits.
+    struct xhibitset_t
+    {
+        enum
+        {
+            MAX_LEVELS = 6
+        };
+
+        inline xhibitset_t() : mNumLevels(0), mNumBits(0) {}
+
+        static u32 words_for(u32 num_bits)
+        {
+            u32 total = 0;
+            u32 n     = num_bits;
+            do
+            {
+                n = (n + 63) >> 6;
+                total += n;
+            } while (n > 1);
+            return total;
+        }
+
+        void init(u64* words, u32 num_bits, bool set_all)
+        {
+            mNumBits = num_bits;
+
+            u32 level_words[MAX_LEVELS];
+            u32 n      = num_bits;
+            mNumLevels = 0;
+            do
+            {
+                ASSERT(mNumLevels < MAX_LEVELS);
+                n                         = (n + 63) >> 6;
+                level_words[mNumLevels++] = n;
+            } while (n > 1);
+
+            // Top level first
+            for (u32 l = 0; l < mNumLevels; ++l)
+            {
+                mLevel[l] = words;
+                words += level_words[mNumLevels - 1 - l];
+            }
+
+            // Build bottom-up, at every level 'n' is the number of bits that are used
+            n = num_bits;
+            for (s32 l = mNumLevels - 1; l >= 0; --l)
+            {
+                u32 const nw = (n + 63) >> 6;
+                for (u32 w = 0; w < nw; ++w)
+                    mLevel[l][w] = set_all ? ~(u64)0 : 0;
+                if (set_all && (n & 63) != 0)
+                    mLevel[l][nw - 1] = ((u64)1 << (n & 63)) - 1;
+                n = nw;
+            }
+        }
+
+        inline bool valid() const { return mNumLevels > 0; }
+        inline bool is_set(u32 bit) const { return (mLevel[mNumLevels - 1][bit >> 6] & ((u64)1 << (bit & 63))) != 0; }
+
+        void set(u32 bit)
+        {
+            for (s32 l = mNumLevels - 1; l >= 0; --l)
+            {
+                u64&       word     = mLevel[l][bit >> 6];
+                bool const was_zero = (word == 0);
+                word |= ((u64)1 << (bit & 63));
+                if (!was_zero)
+                    break;
+                bit >>= 6;
+            }
+        }
+
+        void clr(u32 bit)
+        {
+            for (s32 l = mNumLevels - 1; l >= 0; --l)
+            {
+                u64& word = mLevel[l][bit >> 6];
+                word &= ~((u64)1 << (bit & 63));
+                if (word != 0)
+                    break;
+                bit >>= 6;
+            }
+        }
+
+        // Returns the lowest set bit, or -1 when no bit is set
+        s32 find() const
+        {
+            if (mLevel[0][0] == 0)
+                return -1;
+            u32 bit = 0;
+            for (u32 l = 0; l < mNumLevels; ++l)
+                bit = (bit << 6) + xoccupancy_t::find_first_bit(mLevel[l][bit]);
+            return (s32)bit;
+        }
+
+        u64* mLevel[MAX_LEVELS];
+        u32  mNumLevels;
+        u32  mNumBits;
+    };
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_HIBITSET_H__
@@ -5,13 +5,18 @@
 #pragma once 
 #endif
 
+#include "xallocator/x_allocator_ext.h"
+
 namespace xcore
 {
-	/// Forward declares
-	class alloc_t;
-
-	/// Heap allocator (dlmalloc allocator)
-	extern alloc_t*	gCreateHeapAllocator(void* mem_begin, u32 mem_size);
+	/// Heap allocator, a general purpose heap in the given block of memory. Sizes are routed to slabs (<= 2 KB),
+	/// page runs (<= 256 KB) and a buddy allocator (<= 32 MB), larger blocks are mapped directly from the OS
+	/// when the platform supports it. The medium tier is left out of a block of less than about 1 MB, a block of
+	/// less than 512 KB is a single TLSF allocator (without the OS fallback). Returns NULL when the block is too
+	/// small for even that.
+	///
+	/// The heap is not thread-safe.
+	extern alloc_ext_t*	gCreateHeapAllocator(void* mem_begin, u32 mem_size);
 };
 
 #endif	/// __X_ALLOCATOR_H__
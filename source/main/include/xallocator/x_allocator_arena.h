@@ -0,0 +1,90 @@
+#ifndef __X_ALLOCATOR_ARENA_H__
+#define __X_ALLOCATOR_ARENA_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+
+namespace xcore
+{
+    /// Arena (bump) allocator.
+    ///
+    /// An allocation is a pointer bump in the current block, there is no per-allocation header and
+    /// deallocate() does nothing. Memory is given back all at once with reset(), or up to a point with
+    /// rewind() to a marker that was taken with get_marker().
+    ///
+    /// When the current block is full a new block is allocated from the parent allocator and chained to
+    /// it. Rewinding gives those blocks back, except for one spare block that is kept so that a workload
+    /// which overflows every frame/request does not hit the parent allocator every time.
+    class arena_t : public alloc_t
+    {
+    public:
+        struct marker_t
+        {
+            void*  mBlock;
+            xbyte* mCursor;
+        };
+
+        /// Bump allocate, @alignment must be a power of 2
+        inline void* alloc(u32 size, u32 alignment = sizeof(void*))
+        {
+            ASSERT(alignment != 0 && (alignment & (alignment - 1)) == 0);
+            xbyte* p = (xbyte*)(((uptr)mCursor + (alignment - 1)) & ~((uptr)alignment - 1));
+            if (p <= mEnd && (uptr)size <= (uptr)(mEnd - p))
+            {
+                mCursor = p + size;
+                return p;
+            }
+            return v_grow(size, alignment);
+        }
+
+        inline marker_t get_marker() const
+        {
+            marker_t marker = {mBlock, mCursor};
+            return marker;
+        }
+
+        /// Free everything that was allocated after @marker was taken
+        virtual void rewind(marker_t const& marker) = 0;
+
+        /// Free everything
+        virtual void reset() = 0;
+
+    protected:
+        inline arena_t() : mBlock(NULL), mCursor(NULL), mEnd(NULL) {}
+
+        virtual void* v_allocate(u32 size, u32 alignment) { return alloc(size, alignment); }
+        virtual u32   v_deallocate(void*) { return 0; }
+
+        /// Slow path of alloc(), chains a new block and allocates from it
+        virtual void* v_grow(u32 size, u32 alignment) = 0;
+
+        void*  mBlock;
+        xbyte* mCursor;
+        xbyte* mEnd;
+    };
+
+    /// Takes a marker on construction and rewinds the arena to it on destruction
+    class arena_scope_t
+    {
+    public:
+        inline arena_scope_t(arena_t* arena) : mArena(arena), mMarker(arena->get_marker()) {}
+        inline ~arena_scope_t() { mArena->rewind(mMarker); }
+
+    private:
+        arena_t*          mArena;
+        arena_t::marker_t mMarker;
+
+        arena_scope_t(const arena_scope_t&);
+        arena_scope_t& operator=(const arena_scope_t&);
+    };
+
+    /// Creates an arena, the arena and its blocks are allocated from @allocator. A block holds @block_size
+    /// bytes, a single allocation that doesn't fit in a block gets a block of its own.
+    extern arena_t* gCreateArenaAllocator(alloc_t* allocator, u32 block_size);
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_ARENA_H__
@@ -0,0 +1,28 @@
+#ifndef __X_ALLOCATOR_BUDDY_H__
+#define __X_ALLOCATOR_BUDDY_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xallocator/x_allocator_ext.h"
+
+namespace xcore
+{
+    /// Buddy allocator for large blocks
+    ///
+    /// Every allocation is a power of 2 multiple of @min_block_size and is aligned on its own size. A free
+    /// block is split in two halves (buddies) until it has the requested size, when a block is freed it is
+    /// merged with its buddy as long as that one is free as well. The buddy of a block is found with an XOR
+    /// of its index, the free blocks of every size are tracked in a hierarchical bitmap so a free block is
+    /// found with a few bit scans. There are no headers and no alignment gaps.
+    ///
+    /// The memory is taken from @allocator in one piece, @num_max_blocks blocks of @max_block_size bytes.
+    ///
+    /// @min_block_size  Smallest block, a power of 2 (e.g. 64 KB)
+    /// @max_block_size  Largest block, a power of 2 (e.g. 32 MB), at most 2^31 times @min_block_size
+    extern alloc_ext_t* gCreateBuddyAllocator(alloc_t* allocator, u32 min_block_size, u32 max_block_size, u32 num_max_blocks);
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_BUDDY_H__
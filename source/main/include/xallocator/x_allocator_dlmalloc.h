@@ -4,13 +4,20 @@
 #ifdef USE_PRAGMA_ONCE
 #pragma once
 #endif
+
+#include "xallocator/x_allocator_ext.h"
+
 namespace xcore
 {
     /// Forward declares
-    class alloc_t;
+    class page_provider_t;
 
     /// A custom allocator; Doug Lea malloc
-    extern alloc_t* gCreateDlAllocator(void* mem, u32 memsize);
+    extern alloc_ext_t* gCreateDlAllocator(void* mem, u32 memsize);
+
+    /// Doug Lea malloc that takes segments of (at least) @segment_size bytes from @pages, more segments are
+    /// added when needed and segments that became empty are given back
+    extern alloc_ext_t* gCreateDlAllocator(alloc_t* allocator, page_provider_t* pages, u32 segment_size);
 
 }; // namespace xcore
 
@@ -0,0 +1,77 @@
+#ifndef __X_ALLOCATOR_EXT_H__
+#define __X_ALLOCATOR_EXT_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+#include "xbase/x_memory.h"
+
+namespace xcore
+{
+    /// Extended allocator interface of the heaps in this library
+    ///
+    /// alloc_t only hands out and takes back memory, a heap that keeps its block sizes out-of-band can also
+    /// tell the usable size of a block (the size of its size class, at least the size that was requested).
+    ///
+    /// Sized deallocation: the caller passes the size and alignment that it gave to allocate(), or any size
+    /// between that and usable_size(). A heap can then skip the lookups that find the size or the owner of a
+    /// block, debug builds verify the size. A size below the requested one can send the block to the wrong
+    /// tier (a medium block freed as a small one). The default is a plain deallocate.
+    ///
+    /// allocate_at_least() returns the usable size together with the block, a growable buffer can then use
+    /// the rounding slack of the size class instead of reallocating early. The default asks usable_size().
+    ///
+    /// reallocate() resizes a block, the content is kept up to the smaller of the old and the new size. The
+    /// default moves it to a new block of @size bytes and @alignment, a heap that can do better overrides it.
+    /// Returns NULL when there is no memory, the old block is then left alone.
+    class alloc_ext_t : public alloc_t
+    {
+    public:
+        using alloc_t::deallocate;
+
+        inline void* allocate_at_least(u32 size, u32 alignment, u32& outSize) { return v_allocate_at_least(size, alignment, outSize); }
+        inline u32   deallocate(void* ptr, u32 size, u32 alignment) { return v_deallocate_sized(ptr, size, alignment); }
+        inline u32 usable_size(void* ptr) const { return v_usable_size(ptr); }
+        inline void* reallocate(void* ptr, u32 size, u32 alignment) { return v_reallocate(ptr, size, alignment); }
+
+    protected:
+        virtual void* v_allocate_at_least(u32 size, u32 alignment, u32& outSize)
+        {
+            void* ptr = v_allocate(size, alignment);
+            outSize   = ptr != NULL ? v_usable_size(ptr) : 0;
+            return ptr;
+        }
+        virtual u32 v_deallocate_sized(void* ptr, u32, u32) { return v_deallocate(ptr); }
+        virtual u32 v_usable_size(void* ptr) const = 0;
+        virtual void* v_reallocate(void* ptr, u32 size, u32 alignment)
+        {
+            void* mem = v_allocate(size, alignment);
+            if (mem != NULL && ptr != NULL)
+            {
+                u32 const old_size = v_usable_size(ptr);
+                x_memcpy(mem, ptr, size < old_size ? size : old_size);
+                v_deallocate(ptr);
+            }
+            return mem;
+        }
+    };
+
+    /// Sized deallocation when the type of the allocator has it, a plain deallocate otherwise. Resolved at
+    /// compile-time, for code that is generic over the allocator type.
+    inline u32 gDeallocate(alloc_t* allocator, void* ptr, u32, u32) { return allocator->deallocate(ptr); }
+    inline u32 gDeallocate(alloc_ext_t* allocator, void* ptr, u32 size, u32 alignment) { return allocator->deallocate(ptr, size, alignment); }
+
+    /// allocate_at_least() when the type of the allocator has it, otherwise @outSize is the requested size
+    inline void* gAllocateAtLeast(alloc_t* allocator, u32 size, u32 alignment, u32& outSize)
+    {
+        void* ptr = allocator->allocate(size, alignment);
+        outSize   = ptr != NULL ? size : 0;
+        return ptr;
+    }
+    inline void* gAllocateAtLeast(alloc_ext_t* allocator, u32 size, u32 alignment, u32& outSize) { return allocator->allocate_at_least(size, alignment, outSize); }
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_EXT_H__
@@ -4,16 +4,44 @@
 #ifdef USE_PRAGMA_ONCE 
 #pragma once 
 #endif
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_ext.h"
+
 namespace xcore
 {
-	/// Forward declares
-	class alloc_t;
-
 	/// The forward allocator is a specialized allocator. You can use it when you are allocating different size blocks that
 	/// all have a life-time that doesn't differ much. This allocator is very fast in allocation O(1), deallocations effectively
 	/// also shows O(1) behavior but due to its coalesce mechanism can sometimes take a tiny bit more time. If you mostly allocate
 	/// and deallocate in a non-random order than deallocation is surely O(1).
-	extern alloc_t*		gCreateForwardAllocator(alloc_t* allocator, u32 memsize);
+	///
+	/// Data of unknown length can be written directly into the allocator with reserve/commit, reserve() returns a
+	/// block of the maximum size and commit() shrinks it to the size that was actually used. The remainder is given
+	/// back immediately, so nothing may be allocated in between. The committed block is freed with deallocate().
+	///
+	/// The usable size of a block is the requested size rounded up to 4.
+	class forward_alloc_t : public alloc_ext_t
+	{
+	public:
+		inline void*		reserve(u32 max_size, u32 alignment)		{ return v_allocate(max_size, alignment); }
+		inline void			commit(void* ptr, u32 size)					{ v_commit(ptr, size); }
+
+	protected:
+		virtual void		v_commit(void* ptr, u32 size) = 0;
+	};
+
+	extern forward_alloc_t*	gCreateForwardAllocator(alloc_t* allocator, u32 memsize);
+
+	/// Segmented forward allocator, instead of failing when full it acquires another segment of @segment_size bytes
+	/// from @allocator and continues there. A segment that became empty is kept around for @retire_delay allocations
+	/// (hysteresis, a burst that comes back can use it again), after that it moves to a cache of at most @max_cached
+	/// segments or is given back to @allocator. An allocation can not be larger than a segment.
+	extern forward_alloc_t*	gCreateSegmentedForwardAllocator(alloc_t* allocator, u32 segment_size, u32 max_cached, u32 retire_delay);
+
+	/// The concurrent forward allocator can be used by many threads at the same time without any locking. An allocation
+	/// is reserved with a single atomic add on the head of the current segment, so producers never wait on each other.
+	/// The memory is divided into @num_segments (2 to 64) segments of @segment_size bytes, a segment is reused once all
+	/// of its allocations have been freed. An allocation can not be larger than a segment.
+	extern alloc_t*		gCreateConcurrentForwardAllocator(alloc_t* allocator, u32 segment_size, u32 num_segments);
 
 };
 
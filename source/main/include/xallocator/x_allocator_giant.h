@@ -0,0 +1,45 @@
+#ifndef __X_ALLOCATOR_GIANT_H__
+#define __X_ALLOCATOR_GIANT_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_ext.h"
+
+namespace xcore
+{
+    /// Giant allocator, every allocation is mapped directly from the OS and unmapped when it is freed.
+    ///
+    /// Meant for blocks of many megabytes, the memory is given back the moment the block is freed instead of
+    /// staying behind in the pool of a heap. The allocations are tracked in a registry (address -> size),
+    /// owns() tells if a pointer is a giant allocation.
+    ///
+    /// reallocate() remaps the pages (mremap), a block is grown or shrunk by changing the page tables, the
+    /// content is never copied. The block may move, the content and alignment are kept. The reallocate() of
+    /// alloc_ext_t does the same, its alignment is ignored.
+    ///
+    /// The usable size of a block is the mapped size, the requested size rounded up to the page size.
+    class giant_alloc_t : public alloc_ext_t
+    {
+    public:
+        using alloc_ext_t::reallocate;
+
+        inline void* reallocate(void* ptr, u64 size) { return v_reallocate(ptr, size); }
+        inline bool  owns(void const* ptr) const { return v_owns(ptr); }
+        inline u64   size_of(void const* ptr) const { return v_size_of(ptr); }
+
+    protected:
+        virtual void* v_reallocate(void* ptr, u64 size) = 0;
+        virtual bool  v_owns(void const* ptr) const     = 0;
+        virtual u64   v_size_of(void const* ptr) const  = 0;
+        virtual void* v_reallocate(void* ptr, u32 size, u32) { return v_reallocate(ptr, (u64)size); }
+    };
+
+    /// The registry is allocated from @allocator. Returns NULL when the platform has no mremap (Linux only).
+    extern giant_alloc_t* gCreateGiantAllocator(alloc_t* allocator);
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_GIANT_H__
@@ -0,0 +1,27 @@
+#ifndef __X_ALLOCATOR_MEDIUM_H__
+#define __X_ALLOCATOR_MEDIUM_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xallocator/x_allocator_ext.h"
+
+namespace xcore
+{
+    /// Medium size allocator, 2 KB to 256 KB
+    ///
+    /// Sizes are rounded up to one of 29 size classes, 4 per power of 2. Every size class carves its
+    /// allocations out of runs of pages, the free slots of a run are tracked in a bitmap. All the state is
+    /// kept out-of-band in a page map (one entry per 4 KB page), an allocation has no header. A run that
+    /// becomes empty is merged back into the free pages, so every size class only holds on to the pages
+    /// that it is using (plus one empty run).
+    ///
+    /// The memory, @memsize bytes, is taken from @allocator in one piece. Allocations smaller than 2 KB use
+    /// the 2 KB class, allocations larger than 256 KB fail. usable_size() is the size of the class.
+    /// Returns NULL when @memsize can not hold one run of the largest size class (256 KB).
+    extern alloc_ext_t* gCreateMediumAllocator(alloc_t* allocator, u32 memsize);
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_MEDIUM_H__
@@ -0,0 +1,110 @@
+#ifndef __X_ALLOCATOR_PMR_H__
+#define __X_ALLOCATOR_PMR_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_ext.h"
+
+#if __cplusplus >= 201703L && defined(__has_include)
+#if __has_include(<memory_resource>)
+#define X_ALLOCATOR_HAS_PMR
+#endif
+#endif
+
+#ifdef X_ALLOCATOR_HAS_PMR
+#include <memory_resource>
+#include <new>
+
+namespace xcore
+{
+    /// std::pmr::memory_resource on top of an alloc_t, any pmr container can then live in a heap of this
+    /// library (std::pmr::vector<int> v(&resource)). Only available with C++17 and <memory_resource>.
+    ///
+    /// Out of memory throws std::bad_alloc, as the standard requires, and so does a size or alignment that
+    /// doesn't fit in the 32 bits of an alloc_t. Two resources are equal only when they
+    /// are the same object. On top of an alloc_ext_t (e.g. a heap) deallocation passes the size on.
+    class xpmr_resource_t : public std::pmr::memory_resource
+    {
+    public:
+        inline explicit xpmr_resource_t(alloc_t* allocator) : mAllocator(allocator), mSized(NULL) {}
+        inline explicit xpmr_resource_t(alloc_ext_t* allocator) : mAllocator(allocator), mSized(allocator) {}
+
+        inline alloc_t* allocator() const { return mAllocator; }
+
+    protected:
+        virtual void* do_allocate(std::size_t bytes, std::size_t alignment)
+        {
+            if (bytes > 0xffffffff || alignment > 0xffffffff)
+                throw std::bad_alloc();
+            void* ptr = mAllocator->allocate((u32)bytes, (u32)alignment);
+            if (ptr == NULL)
+                throw std::bad_alloc();
+            return ptr;
+        }
+
+        virtual void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+        {
+            if (mSized != NULL)
+                mSized->deallocate(ptr, (u32)bytes, (u32)alignment);
+            else
+                mAllocator->deallocate(ptr);
+        }
+
+        virtual bool do_is_equal(std::pmr::memory_resource const& other) const noexcept { return this == &other; }
+
+    private:
+        alloc_t*     mAllocator;
+        alloc_ext_t* mSized;
+    };
+
+    /// std::pmr::memory_resource on top of a fixed size allocator (e.g. a fsadexed_t), allocations that fit in
+    /// an element (size and @alignment of the elements) come from the pool, the others from @upstream.
+    class xpmr_pool_resource_t : public std::pmr::memory_resource
+    {
+    public:
+        inline xpmr_pool_resource_t(fsa_t* pool, u32 alignment, std::pmr::memory_resource* upstream)
+            : mPool(pool)
+            , mUpstream(upstream)
+            , mAlignment(alignment)
+        {
+        }
+
+        inline fsa_t* pool() const { return mPool; }
+
+    protected:
+        inline bool from_pool(std::size_t bytes, std::size_t alignment) const { return bytes <= mPool->size() && alignment <= mAlignment; }
+
+        virtual void* do_allocate(std::size_t bytes, std::size_t alignment)
+        {
+            if (!from_pool(bytes, alignment))
+                return mUpstream->allocate(bytes, alignment);
+            void* ptr = mPool->allocate();
+            if (ptr == NULL)
+                throw std::bad_alloc();
+            return ptr;
+        }
+
+        virtual void do_deallocate(void* ptr, std::size_t bytes, std::size_t alignment)
+        {
+            if (from_pool(bytes, alignment))
+                mPool->deallocate(ptr);
+            else
+                mUpstream->deallocate(ptr, bytes, alignment);
+        }
+
+        virtual bool do_is_equal(std::pmr::memory_resource const& other) const noexcept { return this == &other; }
+
+    private:
+        fsa_t*                     mPool;
+        std::pmr::memory_resource* mUpstream;
+        u32                        mAlignment;
+    };
+
+}; // namespace xcore
+
+#endif // X_ALLOCATOR_HAS_PMR
+
+#endif /// __X_ALLOCATOR_PMR_H__
@@ -0,0 +1,33 @@
+#ifndef __X_ALLOCATOR_REGION_H__
+#define __X_ALLOCATOR_REGION_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+namespace xcore
+{
+    /// Forward declares
+    class alloc_t;
+
+    /// Region allocator
+    ///
+    /// Allocations are bumped into fixed size regions that are taken from the parent allocator. A region
+    /// only counts its live allocations, a deallocate is a single (atomic) decrement and when the count
+    /// drops to zero the whole region is recycled at once. Data that is allocated in many places and
+    /// freed together (e.g. everything belonging to one request) costs N decrements and one recycle.
+    ///
+    /// Regions are aligned on their size, so the region of a pointer is found by masking the address.
+    /// An allocation can not be larger than a region (minus a small header) and deallocate() returns 0
+    /// since there are no per-allocation headers.
+    ///
+    /// allocate() and release() belong to the thread that owns the allocator, deallocate() can be called
+    /// from any thread. The parent allocator is only used by the owning thread.
+    ///
+    /// @region_size     Size of a region, a power of 2
+    /// @max_cached      Number of recycled regions that are kept, more are given back to the parent
+    extern alloc_t* gCreateRegionAllocator(alloc_t* allocator, u32 region_size, u32 max_cached);
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_REGION_H__
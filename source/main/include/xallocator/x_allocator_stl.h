@@ -0,0 +1,152 @@
+#ifndef __X_ALLOCATOR_STL_H__
+#define __X_ALLOCATOR_STL_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_ext.h"
+
+namespace xcore
+{
+    namespace xstl
+    {
+        typedef decltype(sizeof(0)) size_type;
+        typedef decltype((char*)0 - (char*)0) difference_type;
+
+        /// The result of allocate_at_least(), when <memory> is included first and the standard library has
+        /// allocate_at_least (C++23) this is std::allocation_result so that std::allocator_traits accepts it.
+#if defined(__cpp_lib_allocate_at_least)
+        template <typename P> using allocation_result_t = std::allocation_result<P, size_type>;
+#else
+        template <typename P> struct allocation_result_t
+        {
+            P         ptr;
+            size_type count;
+        };
+#endif
+    }; // namespace xstl
+
+    /// std::allocator compatible allocator on top of an alloc_t, for containers that take an allocator type
+    /// (e.g. std::vector<T, xstl_allocator_t<T>>). Does not need any standard header.
+    ///
+    /// The allocator is a pointer, copies and rebinds share the alloc_t and compare equal when they point
+    /// to the same alloc_t. There are no exceptions, allocate() returns NULL when the alloc_t is out of memory
+    /// or when @n objects are more than max_size(), the 32-bit size of an alloc_t. With A = alloc_ext_t (e.g.
+    /// a heap) deallocate() passes the size on.
+    template <typename T, typename A = alloc_t> class xstl_allocator_t
+    {
+    public:
+        typedef T                     value_type;
+        typedef T*                    pointer;
+        typedef T const*              const_pointer;
+        typedef xstl::size_type       size_type;
+        typedef xstl::difference_type difference_type;
+
+        template <typename U> struct rebind
+        {
+            typedef xstl_allocator_t<U, A> other;
+        };
+
+        inline xstl_allocator_t(A* allocator) : mAllocator(allocator) {}
+        template <typename U> inline xstl_allocator_t(xstl_allocator_t<U, A> const& other) : mAllocator(other.allocator()) {}
+
+        inline T*        allocate(size_type n) { return n <= max_size() ? (T*)mAllocator->allocate((u32)(n * sizeof(T)), (u32)alignof(T)) : NULL; }
+        inline void      deallocate(T* p, size_type n) { gDeallocate(mAllocator, p, (u32)(n * sizeof(T)), (u32)alignof(T)); }
+        inline size_type max_size() const { return (size_type)0xffffffff / sizeof(T); }
+
+        /// Allocate at least @n objects, count is the number of objects that fit in the block. With A = alloc_ext_t
+        /// that is the usable size of the block, a growing container (vector, string) then uses the slack.
+        inline xstl::allocation_result_t<T*> allocate_at_least(size_type n)
+        {
+            u32                           size   = 0;
+            T*                            ptr    = n <= max_size() ? (T*)gAllocateAtLeast(mAllocator, (u32)(n * sizeof(T)), (u32)alignof(T), size) : NULL;
+            xstl::allocation_result_t<T*> result = {ptr, (size_type)(size / sizeof(T))};
+            return result;
+        }
+
+        inline A* allocator() const { return mAllocator; }
+
+    private:
+        A* mAllocator;
+    };
+
+    template <typename T, typename U, typename A> inline bool operator==(xstl_allocator_t<T, A> const& a, xstl_allocator_t<U, A> const& b) { return a.allocator() == b.allocator(); }
+    template <typename T, typename U, typename A> inline bool operator!=(xstl_allocator_t<T, A> const& a, xstl_allocator_t<U, A> const& b) { return a.allocator() != b.allocator(); }
+
+    /// std::allocator compatible allocator on top of a fixed size allocator (e.g. a fsadexed_t), for node based
+    /// containers (list, map, set) where every allocation is a single node. An allocation of one object that
+    /// fits in an element of the pool comes from the pool, anything else (more objects, like the bucket array
+    /// of a hash map, or a larger type) from the fallback alloc_t.
+    ///
+    /// @alignment is the alignment of the elements of the pool. Like xstl_allocator_t, allocate() returns NULL
+    /// when @n objects are more than max_size().
+    template <typename T, typename A = alloc_t> class xstl_pool_allocator_t
+    {
+    public:
+        typedef T                     value_type;
+        typedef T*                    pointer;
+        typedef T const*              const_pointer;
+        typedef xstl::size_type       size_type;
+        typedef xstl::difference_type difference_type;
+
+        template <typename U> struct rebind
+        {
+            typedef xstl_pool_allocator_t<U, A> other;
+        };
+
+        inline xstl_pool_allocator_t(fsa_t* pool, u32 alignment, A* fallback) : mPool(pool), mFallback(fallback), mAlignment(alignment) {}
+        template <typename U>
+        inline xstl_pool_allocator_t(xstl_pool_allocator_t<U, A> const& other) : mPool(other.pool()), mFallback(other.fallback()), mAlignment(other.alignment())
+        {
+        }
+
+        inline T* allocate(size_type n)
+        {
+            if (from_pool(n))
+                return (T*)mPool->allocate();
+            return n <= max_size() ? (T*)mFallback->allocate((u32)(n * sizeof(T)), (u32)alignof(T)) : NULL;
+        }
+
+        inline void deallocate(T* p, size_type n)
+        {
+            if (from_pool(n))
+                mPool->deallocate(p);
+            else
+                gDeallocate(mFallback, p, (u32)(n * sizeof(T)), (u32)alignof(T));
+        }
+
+        /// A node from the pool is exactly one object, the fallback can return more
+        inline xstl::allocation_result_t<T*> allocate_at_least(size_type n)
+        {
+            if (from_pool(n))
+            {
+                xstl::allocation_result_t<T*> result = {(T*)mPool->allocate(), n};
+                return result;
+            }
+            u32                           size   = 0;
+            T*                            ptr    = n <= max_size() ? (T*)gAllocateAtLeast(mFallback, (u32)(n * sizeof(T)), (u32)alignof(T), size) : NULL;
+            xstl::allocation_result_t<T*> result = {ptr, (size_type)(size / sizeof(T))};
+            return result;
+        }
+
+        inline size_type max_size() const { return (size_type)0xffffffff / sizeof(T); }
+        inline fsa_t*    pool() const { return mPool; }
+        inline A*        fallback() const { return mFallback; }
+        inline u32       alignment() const { return mAlignment; }
+
+    private:
+        inline bool from_pool(size_type n) const { return n == 1 && sizeof(T) <= mPool->size() && alignof(T) <= mAlignment; }
+
+        fsa_t* mPool;
+        A*     mFallback;
+        u32    mAlignment;
+    };
+
+    template <typename T, typename U, typename A> inline bool operator==(xstl_pool_allocator_t<T, A> const& a, xstl_pool_allocator_t<U, A> const& b) { return a.pool() == b.pool() && a.fallback() == b.fallback(); }
+    template <typename T, typename U, typename A> inline bool operator!=(xstl_pool_allocator_t<T, A> const& a, xstl_pool_allocator_t<U, A> const& b) { return !(a == b); }
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_STL_H__
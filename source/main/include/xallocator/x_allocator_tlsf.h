@@ -5,13 +5,64 @@
 #pragma once
 #endif
 
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_ext.h"
+
 namespace xcore
 {
-    /// Forward declares
-    class alloc_t;
+    /// Fit policy of a TLSF allocator or heap, a trade of allocation speed against fragmentation
+    ///
+    /// Good-fit takes the first block of the first free list at or above the size class of the request rounded
+    /// up, any block in there fits (O(1)). Best-fit first looks at a few blocks of the exact size class of the
+    /// request and takes the smallest that fits, a block of the exact size is not split and the larger ones stay
+    /// intact. Address-ordered keeps every free list sorted on address and takes the lowest block that fits,
+    /// allocations cluster at the start of the pools and the free space at the end stays contiguous. Inserting a
+    /// free block is then O(n) in the length of its free list, the price for the lowest fragmentation.
+    enum ETlsfFit
+    {
+        TLSF_FIT_GOOD    = 0,
+        TLSF_FIT_BEST    = 1,
+        TLSF_FIT_ADDRESS = 2,
+    };
 
     /// A custom allocator; 'Two-Level Segregate Fit' allocator
-    extern alloc_t* gCreateTlsfAllocator(void* mem, u32 memsize);
+    extern alloc_ext_t* gCreateTlsfAllocator(void* mem, u32 memsize, ETlsfFit fit = TLSF_FIT_GOOD);
+
+    /// A growable TLSF heap that can have child heaps.
+    ///
+    /// The heap takes pools of memory from its parent allocator and adds another pool whenever an
+    /// allocation doesn't fit. A child heap takes its pools from this heap, so everything that lives in a
+    /// child also lives in one of the pools of its parent.
+    ///
+    /// Releasing a heap releases all of its children (and their children) first. Their pools are not
+    /// given back one by one, they are part of the pools of this heap, which are returned to the parent
+    /// allocator. The cost is O(pools + heaps), the number of allocations doesn't matter.
+    ///
+    /// get_stats() rolls up the numbers of this heap and all of its descendants.
+    ///
+    /// A child heap has the fit policy of its parent.
+    class tlsf_heap_t : public alloc_ext_t
+    {
+    public:
+        struct stats_t
+        {
+            u64 mReserved; // Bytes taken from the parent allocator by the root of the query
+            u64 mUsed;     // Bytes of live allocations, not counting pools and headers of child heaps
+            u32 mPools;    // Number of pools in the hierarchy
+            u32 mHeaps;    // Number of heaps in the hierarchy
+        };
+
+        /// Creates a child heap that grows in steps of @pool_size bytes
+        inline tlsf_heap_t* create_child(u32 pool_size) { return v_create_child(pool_size); }
+        inline void         get_stats(stats_t& stats) const { v_get_stats(stats); }
+
+    protected:
+        virtual tlsf_heap_t* v_create_child(u32 pool_size)     = 0;
+        virtual void         v_get_stats(stats_t& stats) const = 0;
+    };
+
+    /// Creates a root heap that takes pools of @pool_size bytes from @allocator
+    extern tlsf_heap_t* gCreateTlsfHeap(alloc_t* allocator, u32 pool_size, ETlsfFit fit = TLSF_FIT_GOOD);
 
 }; // namespace xcore
 
@@ -0,0 +1,103 @@
+#ifndef __X_ALLOCATOR_FORWARD_RING_H__
+#define __X_ALLOCATOR_FORWARD_RING_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+
+namespace xcore
+{
+    /// Single-producer single-consumer ring of variable size messages.
+    ///
+    /// This is the forward allocator specialized for one producer thread that allocates messages and
+    /// one consumer thread that frees them in the same (FIFO) order. Memory is taken from the head and
+    /// given back at the tail, when a message doesn't fit in the space left at the end of the ring a
+    /// wrap marker is written and the message is allocated at the start. When the tail and the message
+    /// don't fit together, allocate() publishes the wrap marker on its own and returns NULL. Once the
+    /// consumer has stepped over it a retry allocates at the start, so any size up to capacity() minus
+    /// HEADER_SIZE can be allocated from an empty ring.
+    ///
+    /// Neither side takes a lock. publish() makes all messages allocated so far visible to the consumer
+    /// (release), peek() sees them (acquire). deallocate() hands the space of the message returned by
+    /// peek() back to the producer (release).
+    ///
+    /// Producer:                               Consumer:
+    ///     msg = ring->allocate(size);             while ((msg = ring->peek(size)) != NULL)
+    ///     <write msg>                             {
+    ///     ring->publish();                            <read msg>
+    ///                                                 ring->deallocate();
+    ///                                             }
+    ///
+    /// A mirrored ring maps the same memory twice, back-to-back, in virtual memory. A message can then
+    /// straddle the end of the ring and still be contiguous, there is no wrap-around and no space is
+    /// wasted at the end.
+    class forward_ring_t
+    {
+    public:
+        enum
+        {
+            HEADER_SIZE = 8,
+            ALIGNMENT   = 8,
+            CACHE_LINE  = 64,
+        };
+
+        forward_ring_t(alloc_t* allocator, xbyte* memory, u32 capacity, bool mirrored = false);
+
+        inline u32  capacity() const { return mCapacity; }
+        inline bool mirrored() const { return mMirrored; }
+
+        // Producer, returns NULL when the ring has no room for @size bytes
+        void* allocate(u32 size);
+        void  publish();
+
+        // Consumer, returns the oldest published message or NULL
+        void* peek(u32& outSize);
+        void  deallocate();
+
+        void release();
+
+        XCORE_CLASS_PLACEMENT_NEW_DELETE
+
+    protected:
+        alloc_t* mAllocator;
+        xbyte*   mMemory;
+        u32      mCapacity;
+        u32      mMask;
+        bool     mMirrored;
+
+        // Positions are byte counters that only increase, the offset in the ring is (position & mMask)
+        // Shared state, each on its own cache line
+        xbyte        mPadding0[CACHE_LINE];
+        u32 volatile mPublished;
+        xbyte        mPadding1[CACHE_LINE - sizeof(u32)];
+        u32 volatile mReleased;
+        xbyte        mPadding2[CACHE_LINE - sizeof(u32)];
+
+        // Producer state
+        u32   mWrite;
+        u32   mCachedReleased;
+        xbyte mPadding3[CACHE_LINE - 2 * sizeof(u32)];
+
+        // Consumer state
+        u32 mRead;
+        u32 mCachedPublished;
+        u32 mPeekSize;
+
+    private:
+        forward_ring_t(const forward_ring_t&);
+        forward_ring_t& operator=(const forward_ring_t&);
+    };
+
+    /// Creates a ring of @memsize bytes (rounded up to a power of 2), memory comes from @allocator
+    extern forward_ring_t* gCreateForwardRing(alloc_t* allocator, u32 memsize);
+
+    /// Creates a mirrored ring of @memsize bytes (rounded up to a power of 2 and to the page size), the memory
+    /// is mapped directly from the OS. Only @allocator is used for the ring object. Returns NULL when the
+    /// platform does not support it (currently Linux only, using memfd).
+    extern forward_ring_t* gCreateMirroredForwardRing(alloc_t* allocator, u32 memsize);
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_FORWARD_RING_H__
@@ -5,6 +5,8 @@
 #pragma once 
 #endif
 
+#include "xallocator/x_occupancy.h"
+
 namespace xcore
 {
 	/// Forward declares
@@ -17,6 +19,84 @@ namespace xcore
 
 	extern fsadexed_t* gCreateFreeListIdxAllocator(alloc_t* allocator, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements);
     extern fsadexed_t* gCreateFreeListIdxAllocator(alloc_t* allocator, void* inElementArray, u32 inSizeOfElement, u32 inElementAlignment, u32 inMaxNumElements);
+
+    /// Array indexed allocator
+    extern fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, alloc_t* object_array_allocator, u32 size_of_object, u32 object_alignment, u32 size);
+    extern fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, void* object_array, u32 size_of_object, u32 object_alignment, u32 size);
+
+    /// Variants that maintain an occupancy bitmap (one bit per element, allocated from @allocator) so that
+    /// the live objects can be enumerated without keeping a separate list, see xoccupancy_t.
+    /// The returned view stays valid until the allocator is released.
+    extern fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, alloc_t* object_array_allocator, u32 size_of_object, u32 object_alignment, u32 size, xoccupancy_t& outOccupancy);
+    extern fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, void* object_array, u32 size_of_object, u32 object_alignment, u32 size, xoccupancy_t& outOccupancy);
+
+    /// Width of the indices of an array indexed allocator. A smaller width limits the number of objects
+    /// (16-bit: 65535, 24-bit: 16777215) but also lowers the minimum object size and alignment, since the
+    /// free list links are stored in the free objects. External references can use xidx16_t and xidx24_t.
+    enum EIndexWidth
+    {
+        INDEX_WIDTH_16 = 2,
+        INDEX_WIDTH_24 = 3,
+        INDEX_WIDTH_32 = 4,
+    };
+
+    extern fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, alloc_t* object_array_allocator, u32 size_of_object, u32 object_alignment, u32 size, EIndexWidth index_width);
+    extern fsadexed_t* gCreateArrayIdxAllocator(alloc_t* allocator, void* object_array, u32 size_of_object, u32 object_alignment, u32 size, EIndexWidth index_width);
+
+    /// Compact storage for an index, converts to and from the u32 index of fsadexed_t where the
+    /// NILL index (0xffffffff) is stored as all bits set.
+    struct xidx16_t
+    {
+        inline xidx16_t() : mIndex(0xffff) {}
+        inline xidx16_t(u32 index) : mIndex((u16)index) {}
+        inline operator u32() const { return mIndex == 0xffff ? 0xffffffff : (u32)mIndex; }
+
+        u16 mIndex;
+    };
+
+    struct xidx24_t
+    {
+        inline xidx24_t() { mIndex[0] = mIndex[1] = mIndex[2] = 0xff; }
+        inline xidx24_t(u32 index)
+        {
+            mIndex[0] = (u8)(index);
+            mIndex[1] = (u8)(index >> 8);
+            mIndex[2] = (u8)(index >> 16);
+        }
+        inline operator u32() const
+        {
+            u32 const index = (u32)mIndex[0] | ((u32)mIndex[1] << 8) | ((u32)mIndex[2] << 16);
+            return index == 0xffffff ? 0xffffffff : index;
+        }
+
+        u8 mIndex[3];
+    };
+
+    /// Allocation policy of the free list allocators
+    ///   LIFO                  Hands out the most recently freed element first (default)
+    ///   LOWEST_INDEX_FIRST    Always hands out the lowest free index using a hierarchical bitmap (O(log64 N)), after
+    ///                         churn the live elements stay packed at the front of the array and the tail remains untouched
+    enum EFreeListPolicy
+    {
+        FREELIST_POLICY_LIFO               = 0,
+        FREELIST_POLICY_LOWEST_INDEX_FIRST = 1,
+    };
+
+    /// Options of the free list allocators
+    ///   mPolicy       Allocation policy
+    ///   mOccupancy    Optional (NULL), receives an occupancy bitmap view that works as for the array indexed allocator
+    struct xfreelist_options_t
+    {
+        inline xfreelist_options_t(EFreeListPolicy policy = FREELIST_POLICY_LIFO, xoccupancy_t* occupancy = NULL) : mPolicy(policy), mOccupancy(occupancy) {}
+
+        EFreeListPolicy mPolicy;
+        xoccupancy_t*   mOccupancy;
+    };
+
+    extern fsadexed_t* gCreateFreeListAllocator(alloc_t* allocator, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements, xfreelist_options_t const& inOptions);
+    extern fsadexed_t* gCreateFreeListAllocator(alloc_t* allocator, void* inElementArray, u32 inSizeOfElement, u32 inElementAlignment, u32 inMaxNumElements, xfreelist_options_t const& inOptions);
+    extern fsadexed_t* gCreateFreeListIdxAllocator(alloc_t* allocator, u32 inSizeOfElement, u32 inElementAlignment, u32 inNumElements, xfreelist_options_t const& inOptions);
+    extern fsadexed_t* gCreateFreeListIdxAllocator(alloc_t* allocator, void* inElementArray, u32 inSizeOfElement, u32 inElementAlignment, u32 inMaxNumElements, xfreelist_options_t const& inOptions);
 };
 
 
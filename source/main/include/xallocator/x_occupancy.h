@@ -0,0 +1,188 @@
+#ifndef __X_ALLOCATOR_OCCUPANCY_H__
+#define __X_ALLOCATOR_OCCUPANCY_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_debug.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#include <intrin.h>
+#endif
+
+namespace xcore
+{
+    /// Occupancy bitmap of an indexed allocator, one bit per index which is set while that index is allocated.
+    /// This is a read-only view, the bitmap itself is owned and maintained by the allocator.
+    ///
+    /// Iteration works on 64-bit words, using a bit-scan to jump directly to the next live index and testing
+    /// 4 words (256 slots) at once to skip over empty regions.
+    struct xoccupancy_t
+    {
+        inline xoccupancy_t() : mBits(NULL), mNumBits(0) {}
+        inline xoccupancy_t(u64 const* bits, u32 num_bits) : mBits(bits), mNumBits(num_bits) {}
+
+        inline bool valid() const { return mBits != NULL; }
+        inline u32  capacity() const { return mNumBits; }
+        inline bool is_live(u32 index) const { return index < mNumBits && (mBits[index >> 6] & ((u64)1 << (index & 63))) != 0; }
+
+        u32 count() const
+        {
+            u32       n     = 0;
+            u32 const words = num_words(mNumBits);
+            for (u32 w = 0; w < words; ++w)
+                n += count_bits(mBits[w]);
+            return n;
+        }
+
+        /// Calls f(index) for every live index in [from, to) in increasing order
+        template <typename F> void for_each_live(F const& f, u32 from, u32 to) const
+        {
+            if (to > mNumBits)
+                to = mNumBits;
+            if (from >= to)
+                return;
+
+            u32       w    = from >> 6;
+            u32 const wend = num_words(to);
+            u64       word = mBits[w] & (~(u64)0 << (from & 63));
+            while (true)
+            {
+                while (word != 0)
+                {
+                    u32 const index = (w << 6) + find_first_bit(word);
+                    if (index >= to)
+                        return;
+                    f(index);
+                    word &= word - 1;
+                }
+                if (++w >= wend)
+                    return;
+
+                // Skip empty regions 256 slots at a time
+                while ((w + 4) <= wend && (mBits[w] | mBits[w + 1] | mBits[w + 2] | mBits[w + 3]) == 0)
+                    w += 4;
+                if (w >= wend)
+                    return;
+                word = mBits[w];
+            }
+        }
+
+        template <typename F> void for_each_live(F const& f) const { for_each_live(f, 0, mNumBits); }
+
+        /// Parallel variant; the bitmap is split into @chunk_count ranges on 64-bit word boundaries and
+        /// this call visits the range selected by @chunk_index. Ranges never share a word so a thread pool
+        /// can run all chunks concurrently, as long as the allocator is not modified at the same time.
+        template <typename F> void for_each_live_chunk(F const& f, u32 chunk_index, u32 chunk_count) const
+        {
+            ASSERT(chunk_count > 0);
+            if (chunk_count == 0)
+                return;
+            u32 const words    = num_words(mNumBits);
+            u32 const per_task = (words + chunk_count - 1) / chunk_count;
+            u32 const from     = chunk_index * per_task;
+            u32 const to       = from + per_task;
+            if (from < words)
+                for_each_live(f, from << 6, (to < words ? to : words) << 6);
+        }
+
+        class iterator
+        {
+        public:
+            inline iterator(xoccupancy_t const* occupancy, u32 word) : mOccupancy(occupancy), mWord(word), mWordBits(0)
+            {
+                if (mWord < num_words(mOccupancy->mNumBits))
+                {
+                    mWordBits = mOccupancy->mBits[mWord];
+                    skip();
+                }
+            }
+
+            inline u32       operator*() const { return (mWord << 6) + find_first_bit(mWordBits); }
+            inline iterator& operator++()
+            {
+                mWordBits &= mWordBits - 1;
+                skip();
+                return *this;
+            }
+            inline bool operator==(iterator const& other) const { return mWord == other.mWord && mWordBits == other.mWordBits; }
+            inline bool operator!=(iterator const& other) const { return mWord != other.mWord || mWordBits != other.mWordBits; }
+
+        private:
+            inline void skip()
+            {
+                u32 const words = num_words(mOccupancy->mNumBits);
+                while (mWordBits == 0 && ++mWord < words)
+                    mWordBits = mOccupancy->mBits[mWord];
+            }
+
+            xoccupancy_t const* mOccupancy;
+            u32                 mWord;
+            u64                 mWordBits;
+        };
+
+        inline iterator begin() const { return iterator(this, 0); }
+        inline iterator end() const { return iterator(this, num_words(mNumBits)); }
+
+        // Helpers for the allocators that maintain a bitmap
+        static inline u32  num_words(u32 num_bits) { return (num_bits + 63) >> 6; }
+        static inline void set_live(u64* bits, u32 index) { bits[index >> 6] |= ((u64)1 << (index & 63)); }
+        static inline void set_free(u64* bits, u32 index) { bits[index >> 6] &= ~((u64)1 << (index & 63)); }
+
+#if defined(__GNUC__) || defined(__clang__)
+        static inline s32 find_first_bit(u64 word) { return word ? __builtin_ctzll(word) : -1; }
+        static inline s32 find_last_bit(u64 word) { return word ? 63 - __builtin_clzll(word) : -1; }
+        static inline s32 count_bits(u64 word) { return __builtin_popcountll(word); }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+        static inline s32 find_first_bit(u64 word)
+        {
+            unsigned long index;
+            return _BitScanForward64(&index, word) ? (s32)index : -1;
+        }
+        static inline s32 find_last_bit(u64 word)
+        {
+            unsigned long index;
+            return _BitScanReverse64(&index, word) ? (s32)index : -1;
+        }
+        static inline s32 count_bits(u64 word) { return (s32)__popcnt64(word); }
+#else
+        static inline s32 find_first_bit(u64 word)
+        {
+            if (word == 0)
+                return -1;
+            s32 bit = 0;
+            if ((word & 0xffffffff) == 0) { word >>= 32; bit += 32; }
+            if ((word & 0xffff) == 0) { word >>= 16; bit += 16; }
+            if ((word & 0xff) == 0) { word >>= 8; bit += 8; }
+            if ((word & 0xf) == 0) { word >>= 4; bit += 4; }
+            if ((word & 0x3) == 0) { word >>= 2; bit += 2; }
+            if ((word & 0x1) == 0) { bit += 1; }
+            return bit;
+        }
+        static inline s32 find_last_bit(u64 word)
+        {
+            s32 bit = -1;
+            while (word != 0)
+            {
+                word >>= 1;
+                bit += 1;
+            }
+            return bit;
+        }
+        static inline s32 count_bits(u64 word)
+        {
+            word = word - ((word >> 1) & 0x5555555555555555ULL);
+            word = (word & 0x3333333333333333ULL) + ((word >> 2) & 0x3333333333333333ULL);
+            word = (word + (word >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+            return (s32)((word * 0x0101010101010101ULL) >> 56);
+        }
+#endif
+
+        u64 const* mBits;
+        u32        mNumBits;
+    };
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_OCCUPANCY_H__
@@ -0,0 +1,73 @@
+#ifndef __X_ALLOCATOR_PAGE_PROVIDER_H__
+#define __X_ALLOCATOR_PAGE_PROVIDER_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+
+namespace xcore
+{
+    /// Page provider, the source of the memory of a heap
+    ///
+    /// Address space is reserved first and committed (made usable) in parts, committed pages can be
+    /// decommitted again to give the physical memory back while keeping the address space. Sizes and
+    /// addresses passed to commit/decommit/release are multiples of page_size().
+    ///
+    /// The backing strategy (prefault, transparent huge pages, hugetlb, memfd) is a property of the
+    /// provider, a heap doesn't need to know. Heaps that take a parent allocator use a provider through
+    /// gCreatePageAllocator().
+    class page_provider_t
+    {
+    public:
+        inline u32   page_size() const { return v_page_size(); }
+        inline void* reserve(u64 size, u64 alignment) { return v_reserve(size, alignment); }
+        inline bool  commit(void* addr, u64 size) { return v_commit(addr, size); }
+        inline void  decommit(void* addr, u64 size) { v_decommit(addr, size); }
+        inline void  release(void* addr, u64 size) { v_release(addr, size); }
+
+        /// Destroys the provider, all reserved memory must have been released
+        inline void destroy() { v_destroy(); }
+
+    protected:
+        virtual u32   v_page_size() const                = 0;
+        virtual void* v_reserve(u64 size, u64 alignment) = 0;
+        virtual bool  v_commit(void* addr, u64 size)     = 0;
+        virtual void  v_decommit(void* addr, u64 size)   = 0;
+        virtual void  v_release(void* addr, u64 size)    = 0;
+        virtual void  v_destroy()                        = 0;
+
+        virtual ~page_provider_t() {}
+    };
+
+    enum EPageFlags
+    {
+        PAGES_DEFAULT   = 0,
+        PAGES_PREFAULT  = 1, // Populate pages when they are committed instead of on first touch
+        PAGES_HUGE_HINT = 2, // Ask for transparent huge pages
+    };
+
+    /// Pages from a fixed block of memory owned by the caller. Commit and decommit do nothing, released
+    /// address space is reused when it is at the end of what has been reserved (stack order).
+    extern page_provider_t* gCreateStaticPageProvider(alloc_t* allocator, void* mem, u64 memsize, u32 page_size);
+
+    /// Anonymous virtual memory, reserve maps inaccessible address space and commit makes it read/write.
+    /// @flags is a combination of EPageFlags.
+    extern page_provider_t* gCreateVirtualPageProvider(alloc_t* allocator, u32 flags);
+
+    /// Explicit huge pages (hugetlb), the page size is the default huge page size of the system. Returns NULL
+    /// when the platform doesn't support it, a reserve fails when the system has no huge pages available.
+    extern page_provider_t* gCreateHugePageProvider(alloc_t* allocator, u32 flags);
+
+    /// Pages backed by an anonymous memory file (memfd), decommit punches a hole in the file. Returns NULL
+    /// when the platform doesn't support it.
+    extern page_provider_t* gCreateMemfdPageProvider(alloc_t* allocator, u32 flags);
+
+    /// An allocator that maps every allocation to its own range of pages, meant as the parent allocator of a
+    /// heap. The first page of a range holds the bookkeeping, so this only makes sense for large blocks.
+    extern alloc_t* gCreatePageAllocator(alloc_t* allocator, page_provider_t* provider);
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_PAGE_PROVIDER_H__
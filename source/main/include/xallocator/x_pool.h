@@ -0,0 +1,182 @@
+#ifndef __X_ALLOCATOR_POOL_H__
+#define __X_ALLOCATOR_POOL_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+
+#include <new>
+
+namespace xcore
+{
+    namespace xpool_detail
+    {
+        // An element is either a live object or a link in the free list (index of the next free element)
+        template <typename T> union item_t
+        {
+            u32 mNext;
+            alignas(T) xbyte mData[sizeof(T)];
+        };
+
+        // Element array, embedded when the capacity is known at compile-time
+        template <typename T, u32 Capacity> class storage_t
+        {
+        public:
+            inline item_t<T>*       items() { return mItems; }
+            inline item_t<T> const* items() const { return mItems; }
+            inline u32              capacity() const { return Capacity; }
+
+        private:
+            item_t<T> mItems[Capacity];
+        };
+
+        // Element array allocated from an allocator, capacity is given at init
+        template <typename T> class storage_t<T, 0>
+        {
+        public:
+            inline storage_t() : mAllocator(NULL), mItems(NULL), mCapacity(0) {}
+            inline ~storage_t() { exit(); }
+
+            void init(alloc_t* allocator, u32 capacity)
+            {
+                ASSERT(mItems == NULL);
+                mAllocator = allocator;
+                mItems     = (item_t<T>*)allocator->allocate(capacity * sizeof(item_t<T>), alignof(item_t<T>));
+                mCapacity  = (mItems != NULL) ? capacity : 0;
+            }
+
+            void exit()
+            {
+                if (mAllocator != NULL)
+                    mAllocator->deallocate(mItems);
+                mAllocator = NULL;
+                mItems     = NULL;
+                mCapacity  = 0;
+            }
+
+            inline item_t<T>*       items() { return mItems; }
+            inline item_t<T> const* items() const { return mItems; }
+            inline u32              capacity() const { return mCapacity; }
+
+        private:
+            alloc_t*   mAllocator;
+            item_t<T>* mItems;
+            u32        mCapacity;
+        };
+    }; // namespace xpool_detail
+
+    /// Typed fixed size object pool, non-virtual and fully inlinable.
+    ///
+    /// Same design as xfreelist_t (free elements are linked by index) but the element size and alignment
+    /// are compile-time constants so index <-> pointer conversion is a shift or a multiply. Elements that
+    /// were never handed out are taken from a high-water mark, so initialization is O(1) and the tail of
+    /// the array is not touched until needed.
+    ///
+    /// xpool_t<T, N>   embeds the storage for N objects
+    /// xpool_t<T>      storage comes from an allocator, call init(allocator, capacity) and exit(), the
+    ///                 destructor releases the storage when exit() was not called
+    template <typename T, u32 Capacity = 0> class xpool_t : public xpool_detail::storage_t<T, Capacity>
+    {
+        typedef xpool_detail::item_t<T>              item_t;
+        typedef xpool_detail::storage_t<T, Capacity> storage_t;
+
+    public:
+        enum
+        {
+            NULL_INDEX = 0xffffffff
+        };
+
+        inline xpool_t() : mFreeHead(NULL_INDEX), mHighWater(0), mUsed(0) {}
+
+        inline u32  size() const { return mUsed; }
+        inline bool empty() const { return mUsed == 0; }
+        inline bool full() const { return mFreeHead == NULL_INDEX && mHighWater == storage_t::capacity(); }
+
+        /// Allocator backed pools only, all objects have to be destroyed before exit()
+        inline void init(alloc_t* allocator, u32 capacity)
+        {
+            reset();
+            storage_t::init(allocator, capacity);
+        }
+
+        inline void exit()
+        {
+            ASSERT(mUsed == 0);
+            storage_t::exit();
+            reset();
+        }
+
+        /// Raw storage for one T, NULL when the pool is full
+        inline T* allocate()
+        {
+            u32 idx = mFreeHead;
+            if (idx != NULL_INDEX)
+                mFreeHead = storage_t::items()[idx].mNext;
+            else if (mHighWater < storage_t::capacity())
+                idx = mHighWater++;
+            else
+                return NULL;
+            ++mUsed;
+            return (T*)storage_t::items()[idx].mData;
+        }
+
+        inline void deallocate(T* p)
+        {
+            ASSERT(owns(p));
+            item_t* item = (item_t*)p;
+            item->mNext  = mFreeHead;
+            mFreeHead    = (u32)(item - storage_t::items());
+            --mUsed;
+        }
+
+        /// Allocate and construct in-place
+        template <typename... Args> inline T* construct(Args&&... args)
+        {
+            T* p = allocate();
+            if (p != NULL)
+                ::new (p) T(static_cast<Args&&>(args)...);
+            return p;
+        }
+
+        /// Destruct and deallocate
+        inline void destroy(T* p)
+        {
+            if (p != NULL)
+            {
+                p->~T();
+                deallocate(p);
+            }
+        }
+
+        inline T* ptr_of(u32 idx) const
+        {
+            ASSERT(idx == NULL_INDEX || idx < mHighWater);
+            return idx == NULL_INDEX ? NULL : (T*)storage_t::items()[idx].mData;
+        }
+
+        inline u32 idx_of(T const* p) const { return p == NULL ? (u32)NULL_INDEX : (u32)((item_t const*)p - storage_t::items()); }
+
+        inline bool owns(T const* p) const { return (item_t const*)p >= storage_t::items() && (item_t const*)p < (storage_t::items() + storage_t::capacity()); }
+
+        /// Forget all objects (no destructors are called)
+        inline void reset()
+        {
+            mFreeHead  = NULL_INDEX;
+            mHighWater = 0;
+            mUsed      = 0;
+        }
+
+    private:
+        u32 mFreeHead;
+        u32 mHighWater;
+        u32 mUsed;
+
+        xpool_t(const xpool_t&);
+        xpool_t& operator=(const xpool_t&);
+    };
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_POOL_H__
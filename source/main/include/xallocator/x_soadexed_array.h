@@ -0,0 +1,65 @@
+#ifndef __X_ALLOCATOR_SOADEXED_ARRAY_H__
+#define __X_ALLOCATOR_SOADEXED_ARRAY_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+#include "xallocator/x_occupancy.h"
+
+namespace xcore
+{
+    /// Structure-of-arrays indexed allocator.
+    ///
+    /// An element is split into N fields (columns), every column is a separate array that starts on a
+    /// COLUMN_ALIGNMENT boundary. Allocating an index reserves that slot in all columns, so a loop that only
+    /// reads 2 fields only pulls those 2 columns through the cache.
+    ///
+    /// Indices are handed out lowest-first which keeps the live slots packed at the front; a vectorized
+    /// loop can run over [0, live_end()) of the columns it needs and use occupancy() to skip the holes.
+    ///
+    /// The fsadexed_t interface (allocate/deallocate/idx2ptr/ptr2idx) works on the pointers of column 0.
+    class soadexed_t : public fsadexed_t
+    {
+    public:
+        enum
+        {
+            MAX_COLUMNS      = 16,
+            COLUMN_ALIGNMENT = 64
+        };
+
+        inline u32 capacity() const { return mCapacity; }
+        inline u32 num_columns() const { return mNumColumns; }
+        inline u32 field_size(u32 column) const { return mFieldSizes[column]; }
+
+        inline void*                    column(u32 column) const { return mColumns[column]; }
+        template <typename T> inline T* column_as(u32 column) const { return (T*)mColumns[column]; }
+        inline void*                    field(u32 index, u32 column) const { return mColumns[column] + (index * mFieldSizes[column]); }
+
+        inline xoccupancy_t occupancy() const { return xoccupancy_t(mOccupancy, mCapacity); }
+        inline u32          live_end() const { return mLiveEnd; }
+
+        /// Returns NILL_IDX (0xffffffff) when full
+        virtual u32  iallocate()            = 0;
+        virtual void ideallocate(u32 index) = 0;
+
+    protected:
+        inline soadexed_t() : mNumColumns(0), mCapacity(0), mLiveEnd(0), mOccupancy(NULL) {}
+
+        xbyte* mColumns[MAX_COLUMNS];
+        u32    mFieldSizes[MAX_COLUMNS];
+        u32    mNumColumns;
+        u32    mCapacity;
+        u32    mLiveEnd;
+        u64*   mOccupancy;
+    };
+
+    /// Creates a SoA indexed allocator with @num_fields columns of @field_sizes bytes per element and @size elements.
+    /// The allocator, its bitmaps and column table come from @allocator, the column arrays from @column_allocator.
+    /// Returns NULL when the columns together are larger than 4 GB or when any of the memory can not be allocated.
+    extern soadexed_t* gCreateSoaIdxAllocator(alloc_t* allocator, alloc_t* column_allocator, u32 const* field_sizes, u32 num_fields, u32 size);
+
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_SOADEXED_ARRAY_H__
@@ -0,0 +1,281 @@
+#include "xbase/x_target.h"
+#include "xbase/x_debug.h"
+#include "xbase/x_integer.h"
+#include "xbase/x_allocator.h"
+#include "xbase/x_memory.h"
+
+#include "xallocator/x_allocator.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <new>
+#include <pthread.h>
+#include <stddef.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// -------------------------------------------------------------------------------------------------
+// malloc/free/new/delete interposer, LD_PRELOAD=libxallocator_preload.so <program>
+//
+// All the entry points go to one tiered heap (gCreateHeapAllocator) behind one lock. The heap block
+// is reserved address space (MAP_NORESERVE), pages become resident when the heap touches them. Blocks
+// that don't fit in the heap are mapped directly by its giant allocator.
+//
+// The lock is recursive, the heap is created on the first call and registering the fork handlers may
+// allocate. Around a fork() the lock is held, so the child never sees a heap in the middle of an update,
+// the child continues with a new (unlocked) lock.
+// -------------------------------------------------------------------------------------------------
+namespace xcore
+{
+    namespace xpreload
+    {
+        enum
+        {
+            HEAP_SIZE        = 0xffff0000, // The largest block a heap can manage (u32)
+            MALLOC_ALIGNMENT = 16,         // What malloc guarantees on 64-bit platforms
+        };
+
+        static pthread_mutex_t sLock = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+        static alloc_ext_t*    sHeap = NULL;
+
+        static void on_fork_prepare() { pthread_mutex_lock(&sLock); }
+        static void on_fork_parent() { pthread_mutex_unlock(&sLock); }
+
+        // The thread in the child has another id than the owner of the lock, start with a fresh lock
+        static void on_fork_child()
+        {
+            pthread_mutex_t const unlocked = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+            sLock                          = unlocked;
+        }
+
+        class scoped_lock_t
+        {
+        public:
+            inline scoped_lock_t() { pthread_mutex_lock(&sLock); }
+            inline ~scoped_lock_t() { pthread_mutex_unlock(&sLock); }
+        };
+
+        // Call with the lock held
+        static alloc_ext_t* heap()
+        {
+            if (sHeap == NULL)
+            {
+                void* mem = mmap(NULL, (size_t)HEAP_SIZE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+                if (mem == MAP_FAILED)
+                    return NULL;
+                sHeap = gCreateHeapAllocator(mem, (u32)HEAP_SIZE);
+                if (sHeap == NULL)
+                {
+                    munmap(mem, (size_t)HEAP_SIZE);
+                    return NULL;
+                }
+                pthread_atfork(on_fork_prepare, on_fork_parent, on_fork_child);
+            }
+            return sHeap;
+        }
+
+        static void* allocate(size_t size, size_t alignment)
+        {
+            // alloc_t takes 32-bit sizes
+            if (size > (size_t)0xffffffff - alignment)
+            {
+                errno = ENOMEM;
+                return NULL;
+            }
+
+            void* ptr = NULL;
+            {
+                scoped_lock_t lock;
+                alloc_ext_t*  h = heap();
+                if (h != NULL)
+                    ptr = h->allocate((u32)size, (u32)alignment);
+            }
+            if (ptr == NULL)
+                errno = ENOMEM;
+            return ptr;
+        }
+
+        static void deallocate(void* ptr)
+        {
+            if (ptr == NULL || sHeap == NULL)
+                return;
+            scoped_lock_t lock;
+            sHeap->deallocate(ptr);
+        }
+
+        // Sized delete (C++14), the heap can skip the page map
+        static void deallocate(void* ptr, size_t size, size_t alignment)
+        {
+            if (ptr == NULL || sHeap == NULL)
+                return;
+            scoped_lock_t lock;
+            sHeap->deallocate(ptr, (u32)size, (u32)alignment);
+        }
+
+        static size_t usable_size(void* ptr)
+        {
+            if (ptr == NULL || sHeap == NULL)
+                return 0;
+            scoped_lock_t lock;
+            return sHeap->usable_size(ptr);
+        }
+
+        static void* reallocate(void* ptr, size_t size)
+        {
+            if (ptr == NULL)
+                return allocate(size, MALLOC_ALIGNMENT);
+            if (size == 0)
+            {
+                deallocate(ptr);
+                return NULL;
+            }
+
+            if (size > (size_t)0xffffffff - MALLOC_ALIGNMENT)
+            {
+                errno = ENOMEM;
+                return NULL;
+            }
+
+            // Stay in the same block when the new size still fits and doesn't waste more than half of it,
+            // otherwise the heap moves it (a giant block is remapped instead of copied)
+            scoped_lock_t lock;
+            size_t const  old_size = sHeap->usable_size(ptr);
+            if (size <= old_size && size >= (old_size / 2))
+                return ptr;
+
+            void* mem = sHeap->reallocate(ptr, (u32)size, MALLOC_ALIGNMENT);
+            if (mem == NULL)
+                errno = ENOMEM;
+            return mem;
+        }
+
+        static inline bool is_valid_alignment(size_t alignment) { return alignment != 0 && (alignment & (alignment - 1)) == 0; }
+
+        // operator new; retry through the new handler, throw when there is none
+        static void* allocate_new(size_t size, size_t alignment)
+        {
+            while (true)
+            {
+                void* ptr = allocate(size, alignment);
+                if (ptr != NULL)
+                    return ptr;
+                std::new_handler handler = std::get_new_handler();
+                if (handler == NULL)
+                    throw std::bad_alloc();
+                handler();
+            }
+        }
+
+        static void* allocate_new_nothrow(size_t size, size_t alignment)
+        {
+            try
+            {
+                return allocate_new(size, alignment);
+            }
+            catch (...)
+            {
+                return NULL;
+            }
+        }
+    } // namespace xpreload
+}; // namespace xcore
+
+using namespace xcore;
+
+#define XPRELOAD_API extern "C" __attribute__((visibility("default")))
+
+// -------------------------------------------------------------------------------------------------
+// C
+// -------------------------------------------------------------------------------------------------
+XPRELOAD_API void* malloc(size_t size) { return xpreload::allocate(size, xpreload::MALLOC_ALIGNMENT); }
+XPRELOAD_API void  free(void* ptr) { xpreload::deallocate(ptr); }
+XPRELOAD_API void* realloc(void* ptr, size_t size) { return xpreload::reallocate(ptr, size); }
+XPRELOAD_API size_t malloc_usable_size(void* ptr) { return xpreload::usable_size(ptr); }
+
+XPRELOAD_API void* calloc(size_t count, size_t size)
+{
+    if (size != 0 && count > ((size_t)-1 / size))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    void* ptr = xpreload::allocate(count * size, xpreload::MALLOC_ALIGNMENT);
+    if (ptr != NULL)
+        x_memset(ptr, 0, count * size);
+    return ptr;
+}
+
+XPRELOAD_API void* reallocarray(void* ptr, size_t count, size_t size)
+{
+    if (size != 0 && count > ((size_t)-1 / size))
+    {
+        errno = ENOMEM;
+        return NULL;
+    }
+    return xpreload::reallocate(ptr, count * size);
+}
+
+XPRELOAD_API int posix_memalign(void** result, size_t alignment, size_t size)
+{
+    if (!xpreload::is_valid_alignment(alignment) || (alignment % sizeof(void*)) != 0)
+        return EINVAL;
+    void* ptr = xpreload::allocate(size, alignment);
+    if (ptr == NULL)
+        return ENOMEM;
+    *result = ptr;
+    return 0;
+}
+
+XPRELOAD_API void* aligned_alloc(size_t alignment, size_t size)
+{
+    if (!xpreload::is_valid_alignment(alignment))
+    {
+        errno = EINVAL;
+        return NULL;
+    }
+    return xpreload::allocate(size, alignment);
+}
+
+// The obsolete variants still have users, glibc would serve them from its own heap otherwise
+XPRELOAD_API void* memalign(size_t alignment, size_t size) { return aligned_alloc(alignment, size); }
+XPRELOAD_API void* valloc(size_t size) { return xpreload::allocate(size, (size_t)sysconf(_SC_PAGESIZE)); }
+
+XPRELOAD_API void* pvalloc(size_t size)
+{
+    size_t const page = (size_t)sysconf(_SC_PAGESIZE);
+    return xpreload::allocate((size + page - 1) & ~(page - 1), page);
+}
+
+// -------------------------------------------------------------------------------------------------
+// C++
+// -------------------------------------------------------------------------------------------------
+void* operator new(size_t size) { return xpreload::allocate_new(size, xpreload::MALLOC_ALIGNMENT); }
+void* operator new[](size_t size) { return xpreload::allocate_new(size, xpreload::MALLOC_ALIGNMENT); }
+void* operator new(size_t size, std::nothrow_t const&) noexcept { return xpreload::allocate_new_nothrow(size, xpreload::MALLOC_ALIGNMENT); }
+void* operator new[](size_t size, std::nothrow_t const&) noexcept { return xpreload::allocate_new_nothrow(size, xpreload::MALLOC_ALIGNMENT); }
+
+void operator delete(void* ptr) noexcept { xpreload::deallocate(ptr); }
+void operator delete[](void* ptr) noexcept { xpreload::deallocate(ptr); }
+void operator delete(void* ptr, std::nothrow_t const&) noexcept { xpreload::deallocate(ptr); }
+void operator delete[](void* ptr, std::nothrow_t const&) noexcept { xpreload::deallocate(ptr); }
+
+#if defined(__cpp_sized_deallocation)
+void operator delete(void* ptr, size_t size) noexcept { xpreload::deallocate(ptr, size, xpreload::MALLOC_ALIGNMENT); }
+void operator delete[](void* ptr, size_t size) noexcept { xpreload::deallocate(ptr, size, xpreload::MALLOC_ALIGNMENT); }
+#endif
+
+#if defined(__cpp_aligned_new)
+void* operator new(size_t size, std::align_val_t alignment) { return xpreload::allocate_new(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment) { return xpreload::allocate_new(size, (size_t)alignment); }
+void* operator new(size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept { return xpreload::allocate_new_nothrow(size, (size_t)alignment); }
+void* operator new[](size_t size, std::align_val_t alignment, std::nothrow_t const&) noexcept { return xpreload::allocate_new_nothrow(size, (size_t)alignment); }
+
+void operator delete(void* ptr, std::align_val_t) noexcept { xpreload::deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { xpreload::deallocate(ptr); }
+void operator delete(void* ptr, std::align_val_t, std::nothrow_t const&) noexcept { xpreload::deallocate(ptr); }
+void operator delete[](void* ptr, std::align_val_t, std::nothrow_t const&) noexcept { xpreload::deallocate(ptr); }
+void operator delete(void* ptr, size_t size, std::align_val_t alignment) noexcept { xpreload::deallocate(ptr, size, (size_t)alignment); }
+void operator delete[](void* ptr, size_t size, std::align_val_t alignment) noexcept { xpreload::deallocate(ptr, size, (size_t)alignment); }
+#endif
+
+#endif // __linux__
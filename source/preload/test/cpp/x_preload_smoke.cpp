@@ -0,0 +1,174 @@
+#include <errno.h>
+#include <malloc.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+// -------------------------------------------------------------------------------------------------
+// Smoke test of the preload library, run it as LD_PRELOAD=libxallocator_preload.so xallocator_preload_smoke
+//
+// Threads that allocate and free, realloc of a block that grows to 400 MB (the giant allocator
+// remaps it), fork with another thread in the middle of allocating, and the C++ operators. The exit
+// code is 0 when everything checks out.
+// -------------------------------------------------------------------------------------------------
+
+static int sFailures = 0;
+
+#define SMOKE_CHECK(expr)                                                  \
+    do                                                                     \
+    {                                                                      \
+        if (!(expr))                                                       \
+        {                                                                  \
+            fprintf(stderr, "%s:%d: failed: %s\n", __FILE__, __LINE__, #expr); \
+            ++sFailures;                                                   \
+        }                                                                  \
+    } while (0)
+
+static bool is_preloaded()
+{
+    FILE* maps = fopen("/proc/self/maps", "r");
+    if (maps == NULL)
+        return false;
+    char line[1024];
+    bool found = false;
+    while (!found && fgets(line, sizeof(line), maps) != NULL)
+        found = strstr(line, "xallocator_preload") != NULL;
+    fclose(maps);
+    return found;
+}
+
+static void* churn(void* arg)
+{
+    unsigned int seed = (unsigned int)(size_t)arg;
+    void*        mem[256];
+    size_t       size[256];
+    memset(mem, 0, sizeof(mem));
+    for (int n = 0; n < 200000; ++n)
+    {
+        seed               = seed * 1664525 + 1013904223;
+        unsigned int const i = (seed >> 8) & 255;
+        if (mem[i] == NULL)
+        {
+            size[i] = 1 + ((seed >> 16) & 0x3fff);
+            mem[i]  = malloc(size[i]);
+            if (mem[i] == NULL)
+                return (void*)1;
+            memset(mem[i], (int)(i & 0xff), size[i]);
+        }
+        else
+        {
+            if (((unsigned char*)mem[i])[size[i] - 1] != (unsigned char)i || malloc_usable_size(mem[i]) < size[i])
+                return (void*)1;
+            free(mem[i]);
+            mem[i] = NULL;
+        }
+    }
+    for (int i = 0; i < 256; ++i)
+        free(mem[i]);
+    return NULL;
+}
+
+static void threads()
+{
+    pthread_t thread[8];
+    for (size_t t = 0; t < 8; ++t)
+        SMOKE_CHECK(pthread_create(&thread[t], NULL, churn, (void*)(t + 1)) == 0);
+    for (size_t t = 0; t < 8; ++t)
+    {
+        void* result = (void*)1;
+        pthread_join(thread[t], &result);
+        SMOKE_CHECK(result == NULL);
+    }
+}
+
+static void grow()
+{
+    // Doubling up to 400 MB, the content has to come along every time
+    size_t         size = 1024;
+    unsigned char* mem  = (unsigned char*)malloc(size);
+    SMOKE_CHECK(mem != NULL);
+    memset(mem, 0x5a, size);
+    while (mem != NULL && size < 400 * 1024 * 1024)
+    {
+        size_t const next = size * 2 < 400 * 1024 * 1024 ? size * 2 : 400 * 1024 * 1024;
+        mem               = (unsigned char*)realloc(mem, next);
+        SMOKE_CHECK(mem != NULL);
+        if (mem == NULL)
+            return;
+        SMOKE_CHECK(mem[0] == 0x5a && mem[size - 1] == 0x5a);
+        memset(mem + size, 0x5a, next - size);
+        size = next;
+    }
+    mem = (unsigned char*)realloc(mem, 1024);
+    SMOKE_CHECK(mem != NULL && mem[1023] == 0x5a);
+    free(mem);
+
+    errno = 0;
+    SMOKE_CHECK(malloc((size_t)-1 / 2) == NULL && errno == ENOMEM);
+}
+
+static void fork_while_allocating()
+{
+    pthread_t thread;
+    SMOKE_CHECK(pthread_create(&thread, NULL, churn, (void*)42) == 0);
+    for (int i = 0; i < 8; ++i)
+    {
+        pid_t const pid = fork();
+        if (pid == 0)
+        {
+            // The heap has to be usable in the child, whatever the other thread was doing
+            void* result = churn((void*)(size_t)(100 + i));
+            _exit(result == NULL ? 0 : 1);
+        }
+        int status = -1;
+        SMOKE_CHECK(pid > 0 && waitpid(pid, &status, 0) == pid);
+        SMOKE_CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    }
+    void* result = (void*)1;
+    pthread_join(thread, &result);
+    SMOKE_CHECK(result == NULL);
+}
+
+#if defined(__cpp_aligned_new)
+struct alignas(64) aligned_t
+{
+    char mData[64];
+};
+#endif
+
+static void operators()
+{
+    int* values = new int[1000];
+    values[999] = 1;
+    delete[] values;
+
+#if defined(__cpp_aligned_new)
+    aligned_t* aligned = new aligned_t[3];
+    SMOKE_CHECK(((size_t)aligned & 63) == 0);
+    delete[] aligned;
+#endif
+
+    void* mem = NULL;
+    SMOKE_CHECK(posix_memalign(&mem, 4096, 100) == 0 && ((size_t)mem & 4095) == 0);
+    free(mem);
+}
+
+int main()
+{
+    if (!is_preloaded())
+    {
+        fprintf(stderr, "run with LD_PRELOAD=libxallocator_preload.so\n");
+        return 2;
+    }
+
+    threads();
+    grow();
+    fork_while_allocating();
+    operators();
+
+    printf("%s\n", sFailures == 0 ? "ok" : "FAILED");
+    return sFailures == 0 ? 0 : 1;
+}
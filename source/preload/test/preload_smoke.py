@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+# Runs python3 itself on top of the preload library, a real program with threads, fork and big buffers.
+#
+#     python3 source/preload/test/preload_smoke.py <path to libxallocator_preload.so>
+#
+# The exit code is 0 when the run checks out.
+import os
+import subprocess
+import sys
+import threading
+
+
+def child():
+    with open('/proc/self/maps') as maps:
+        if 'xallocator_preload' not in maps.read():
+            print('the preload library is not loaded')
+            return 2
+
+    # Threads that allocate (the GIL still switches between them in the middle of allocations)
+    def churn(seed):
+        blocks = {}
+        for n in range(200000):
+            seed = (seed * 1664525 + 1013904223) & 0xffffffff
+            i = (seed >> 8) & 255
+            if i in blocks:
+                block = blocks.pop(i)
+                assert block.count(i) == len(block)
+            else:
+                blocks[i] = bytes([i]) * ((seed >> 16) % 4096 + 1)
+    threads = [threading.Thread(target=churn, args=(t,)) for t in range(8)]
+    for t in threads:
+        t.start()
+
+    # A 400 MB buffer that grows in steps, realloc of a giant block
+    buf = bytearray()
+    chunk = b'x' * (1 << 20)
+    for _ in range(400):
+        buf += chunk
+    assert len(buf) == 400 << 20 and buf[-1] == ord('x')
+    del buf
+
+    # Fork while the other threads allocate, the child has to be able to allocate and exit cleanly
+    for _ in range(4):
+        pid = os.fork()
+        if pid == 0:
+            data = [bytes(n) for n in range(2000)]
+            os._exit(0 if len(data) == 2000 else 1)
+        _, status = os.waitpid(pid, 0)
+        assert os.WIFEXITED(status) and os.WEXITSTATUS(status) == 0
+
+    for t in threads:
+        t.join()
+    print('ok')
+    return 0
+
+
+def main():
+    if len(sys.argv) == 2 and sys.argv[1] == '--child':
+        return child()
+    if len(sys.argv) != 2:
+        print('usage: preload_smoke.py <path to libxallocator_preload.so>')
+        return 2
+
+    env = dict(os.environ, LD_PRELOAD=os.path.abspath(sys.argv[1]))
+    return subprocess.call([sys.executable, os.path.abspath(__file__), '--child'], env=env)
+
+
+if __name__ == '__main__':
+    sys.exit(main())
@@ -11,7 +11,18 @@ UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_freelist);
 UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_tlfs);
 UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_freelist);
 UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_forward);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_arena);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_forward_ring);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_region);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_page_provider);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_buddy);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_medium);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_giant);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_heap);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_allocator_stl);
 UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_fsadexed_array);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_pool);
+UNITTEST_SUITE_DECLARE(xAllocatorUnitTest, x_soadexed_array);
 
 namespace xcore
 {
@@ -0,0 +1,101 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_arena.h"
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_allocator_arena)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		UNITTEST_FIXTURE_SETUP()
+		{
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+		}
+
+		UNITTEST_TEST(bump)
+		{
+			arena_t* arena = gCreateArenaAllocator(gSystemAllocator, 4096);
+			CHECK_NOT_NULL(arena);
+
+			// No header, consecutive allocations are adjacent
+			xbyte* p1 = (xbyte*)arena->allocate(16, 8);
+			xbyte* p2 = (xbyte*)arena->allocate(16, 8);
+			CHECK_EQUAL(p1 + 16, p2);
+
+			xbyte* p3 = (xbyte*)arena->allocate(1, 1);
+			xbyte* p4 = (xbyte*)arena->allocate(8, 64);
+			CHECK_EQUAL(p2 + 16, p3);
+			CHECK_EQUAL(0, (s32)((uptr)p4 & 63));
+
+			// Deallocate does nothing
+			arena->deallocate(p4);
+			xbyte* p5 = (xbyte*)arena->allocate(8, 8);
+			CHECK_TRUE(p5 > p4);
+
+			// Sizes where the block header and padding would wrap around
+			CHECK_NULL(arena->allocate(0xfffffff0, 8));
+			CHECK_NULL(arena->allocate(0xffffffff, 1));
+			CHECK_NULL(arena->allocate(0xffffffe8, 64));
+
+			arena->reset();
+			CHECK_EQUAL(p1, (xbyte*)arena->allocate(16, 8));
+
+			arena->release();
+		}
+
+		UNITTEST_TEST(marker_rewind)
+		{
+			arena_t* arena = gCreateArenaAllocator(gSystemAllocator, 1024);
+
+			arena->allocate(100, 8);
+			arena_t::marker_t marker = arena->get_marker();
+			xbyte* p1 = (xbyte*)arena->allocate(200, 8);
+
+			// Overflow into chained blocks, one allocation larger than a block
+			for (s32 i=0; i<20; ++i)
+				CHECK_NOT_NULL(arena->allocate(256, 16));
+			void* big = arena->allocate(8000, 32);
+			CHECK_NOT_NULL(big);
+			CHECK_EQUAL(0, (s32)((uptr)big & 31));
+
+			arena->rewind(marker);
+			CHECK_EQUAL(p1, (xbyte*)arena->allocate(200, 8));
+
+			// Overflowing again should work from the spare block
+			for (s32 i=0; i<20; ++i)
+				CHECK_NOT_NULL(arena->allocate(256, 16));
+
+			arena->release();
+		}
+
+		UNITTEST_TEST(scope)
+		{
+			arena_t* arena = gCreateArenaAllocator(gSystemAllocator, 1024);
+
+			xbyte* p1 = (xbyte*)arena->allocate(32, 8);
+			xbyte* p2;
+			{
+				arena_scope_t scope(arena);
+				p2 = (xbyte*)arena->allocate(32, 8);
+				{
+					arena_scope_t inner(arena);
+					for (s32 i=0; i<10; ++i)
+						arena->allocate(512, 8);
+				}
+				CHECK_EQUAL(p2 + 32, (xbyte*)arena->allocate(32, 8));
+			}
+			CHECK_EQUAL(p1 + 32, p2);
+			CHECK_EQUAL(p2, (xbyte*)arena->allocate(32, 8));
+
+			arena->release();
+		}
+	}
+}
+UNITTEST_SUITE_END
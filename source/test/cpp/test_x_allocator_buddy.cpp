@@ -0,0 +1,124 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_buddy.h"
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_allocator_buddy)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		alloc_ext_t*	gBuddyAllocator;
+
+		UNITTEST_FIXTURE_SETUP()
+		{
+			// 4 KB to 1 MB, 4 MB in total
+			gBuddyAllocator = gCreateBuddyAllocator(gSystemAllocator, 4096, 1024 * 1024, 4);
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+			gBuddyAllocator->release();
+		}
+
+		UNITTEST_TEST(natural_alignment)
+		{
+			u32 const sizes[] = { 1, 4096, 5000, 65536, 100000, 1024 * 1024 };
+			for (s32 i=0; i<6; ++i)
+			{
+				void* mem = gBuddyAllocator->allocate(sizes[i], 8);
+				CHECK_NOT_NULL(mem);
+				u32 const usable = gBuddyAllocator->usable_size(mem);
+				u32 const block = gBuddyAllocator->deallocate(mem);
+				CHECK_EQUAL(block, usable);
+				CHECK_TRUE(block >= sizes[i]);
+				CHECK_TRUE(block < (sizes[i] * 2) || block == 4096);
+			}
+
+			void* mem = gBuddyAllocator->allocate(8192, 8);
+			CHECK_EQUAL(0, (s32)((uptr)mem & 8191));
+			void* aligned = gBuddyAllocator->allocate(4096, 65536);
+			CHECK_EQUAL(0, (s32)((uptr)aligned & 65535));
+			CHECK_EQUAL(65536, (s32)gBuddyAllocator->deallocate(aligned));
+			gBuddyAllocator->deallocate(mem);
+
+			// Too large
+			CHECK_NULL(gBuddyAllocator->allocate(2 * 1024 * 1024, 8));
+		}
+
+		UNITTEST_TEST(split_and_merge)
+		{
+			// Fill everything with the smallest blocks
+			void* mem[1024];
+			for (s32 i=0; i<1024; ++i)
+			{
+				mem[i] = gBuddyAllocator->allocate(4096, 8);
+				CHECK_NOT_NULL(mem[i]);
+			}
+			CHECK_NULL(gBuddyAllocator->allocate(4096, 8));
+
+			// Buddies are next to each other
+			CHECK_EQUAL((xbyte*)mem[0] + 4096, (xbyte*)mem[1]);
+
+			// Free every other block, nothing can merge
+			for (s32 i=0; i<1024; i+=2)
+				gBuddyAllocator->deallocate(mem[i]);
+			CHECK_NULL(gBuddyAllocator->allocate(8192, 8));
+
+			// Free the rest (sized, the order follows from the size), everything merges back into the largest blocks
+			for (s32 i=1; i<1024; i+=2)
+				CHECK_EQUAL(4096, gBuddyAllocator->deallocate(mem[i], 4096, 8));
+
+			void* large[4];
+			for (s32 i=0; i<4; ++i)
+			{
+				large[i] = gBuddyAllocator->allocate(1024 * 1024, 8);
+				CHECK_NOT_NULL(large[i]);
+			}
+			CHECK_NULL(gBuddyAllocator->allocate(4096, 8));
+			for (s32 i=0; i<4; ++i)
+				gBuddyAllocator->deallocate(large[i]);
+		}
+
+		UNITTEST_TEST(random)
+		{
+			void* mem[64];
+			u32 size[64];
+			for (s32 i=0; i<64; ++i)
+				mem[i] = NULL;
+
+			u32 seed = 0x1234567;
+			for (s32 n=0; n<10000; ++n)
+			{
+				seed = seed * 1664525 + 1013904223;
+				s32 const i = (seed >> 8) & 63;
+				if (mem[i] == NULL)
+				{
+					size[i] = 4096 << ((seed >> 16) % 6);
+					mem[i] = gBuddyAllocator->allocate(size[i], 8);
+					if (mem[i] != NULL)
+					{
+						CHECK_EQUAL(0, (s32)((uptr)mem[i] & (size[i] - 1)));
+						*(u32*)mem[i] = size[i];
+					}
+				}
+				else
+				{
+					CHECK_EQUAL(size[i], *(u32*)mem[i]);
+					CHECK_EQUAL(size[i], gBuddyAllocator->deallocate(mem[i]));
+					mem[i] = NULL;
+				}
+			}
+			for (s32 i=0; i<64; ++i)
+				gBuddyAllocator->deallocate(mem[i]);
+
+			// All merged again
+			for (s32 i=0; i<4; ++i)
+				CHECK_NOT_NULL(gBuddyAllocator->allocate(1024 * 1024, 8));
+		}
+	}
+}
+UNITTEST_SUITE_END
@@ -2,6 +2,10 @@
 #include "xallocator/x_allocator_forward.h"
 
 #include "xunittest/xunittest.h"
+#include "test_x_counting_allocator.h"
+
+#include <algorithm>
+#include <thread>
 
 using namespace xcore;
 
@@ -71,6 +75,247 @@ UNITTEST_SUITE_BEGIN(x_allocator_forward)
 			gCustomAllocator->release();
 		}
 
+		UNITTEST_TEST(reserve_commit)
+		{
+			forward_alloc_t* forward = gCreateForwardAllocator(gSystemAllocator, 8 * 1024);
+
+			for (s32 i=0; i<100; ++i)
+			{
+				xbyte* msg = (xbyte*)forward->reserve(4096, 8);
+				CHECK_NOT_NULL(msg);
+				for (s32 b=0; b<40; ++b)
+					msg[b] = (xbyte)b;
+				forward->commit(msg, 40);
+
+				// The remainder went back to the head
+				xbyte* next = (xbyte*)forward->allocate(16, 8);
+				CHECK_NOT_NULL(next);
+				CHECK_TRUE(next > msg && next < (msg + 128));
+
+				// This doesn't fit when the reservation was not shrunk
+				void* big = forward->allocate(6 * 1024, 8);
+				CHECK_NOT_NULL(big);
+
+				CHECK_EQUAL(40, forward->deallocate(msg));
+				forward->deallocate(next);
+				forward->deallocate(big);
+			}
+
+			forward->release();
+		}
+
+		UNITTEST_TEST(segmented)
+		{
+			xcounting_allocator parent(gSystemAllocator);
+
+			// Segments of 4 KB, cache 1 segment, retire empty segments after 256 allocations
+			forward_alloc_t* forward = gCreateSegmentedForwardAllocator(&parent, 4096, 1, 256);
+			CHECK_EQUAL(1, parent.mNumAllocations);
+
+			// A burst of 64 KB needs many segments
+			void* mem[128];
+			for (s32 i=0; i<128; ++i)
+			{
+				mem[i] = forward->allocate(500, 8);
+				CHECK_NOT_NULL(mem[i]);
+			}
+			s32 const peak = parent.mNumAllocations;
+			CHECK_TRUE(peak >= 1 + 16);
+
+			CHECK_NULL(forward->allocate(8192, 8));
+
+			for (s32 i=0; i<128; ++i)
+				forward->deallocate(mem[i]);
+
+			// The same burst again, the empty segments are used again
+			for (s32 i=0; i<128; ++i)
+				mem[i] = forward->allocate(500, 8);
+			CHECK_EQUAL(peak, parent.mNumAllocations);
+			for (s32 i=0; i<128; ++i)
+				forward->deallocate(mem[i]);
+
+			// Steady state, after the retire delay only the current and the cached segment remain
+			for (s32 i=0; i<1024; ++i)
+				forward->deallocate(forward->allocate(100, 8));
+			CHECK_EQUAL(1 + 2, parent.mNumAllocations);
+
+			forward->release();
+			CHECK_EQUAL(0, parent.mNumAllocations);
+		}
+
+		UNITTEST_TEST(segmented_no_fit)
+		{
+			xcounting_allocator parent(gSystemAllocator);
+			forward_alloc_t* forward = gCreateSegmentedForwardAllocator(&parent, 4096, 0, 64);
+
+			void* live = forward->allocate(100, 8);
+			CHECK_EQUAL(2, parent.mNumAllocations);
+
+			// Smaller than a segment but too large for one with the chunk overhead
+			CHECK_NULL(forward->allocate(4090, 8));
+			CHECK_EQUAL(3, parent.mNumAllocations);
+
+			// The segment that was acquired for it is retired
+			for (s32 i=0; i<256; ++i)
+				forward->deallocate(forward->allocate(100, 8));
+			CHECK_EQUAL(2, parent.mNumAllocations);
+
+			forward->deallocate(live);
+			forward->release();
+			CHECK_EQUAL(0, parent.mNumAllocations);
+		}
+
+		UNITTEST_TEST(concurrent_segments)
+		{
+			// 4 segments of 1 KB
+			gCustomAllocator = gCreateConcurrentForwardAllocator(gSystemAllocator, 1024, 4);
+
+			void* mem[64];
+			s32 n = 0;
+			while (n < 64)
+			{
+				void* p = gCustomAllocator->allocate(100, 16);
+				if (p == NULL)
+					break;
+				CHECK_EQUAL(0, (s32)((uptr)p & 15));
+				mem[n++] = p;
+			}
+
+			// Every segment holds 8 allocations of 116 bytes
+			CHECK_EQUAL(32, n);
+			CHECK_NULL(gCustomAllocator->allocate(1, 4));
+
+			// Larger than a segment, also when size + alignment wraps around
+			CHECK_NULL(gCustomAllocator->allocate(2048, 4));
+			CHECK_NULL(gCustomAllocator->allocate(0xfffffff8, 16));
+
+			// Freeing the allocations of the first segment makes it available again
+			for (s32 i=0; i<8; ++i)
+				gCustomAllocator->deallocate(mem[i]);
+			for (s32 i=0; i<8; ++i)
+			{
+				mem[i] = gCustomAllocator->allocate(100, 16);
+				CHECK_NOT_NULL(mem[i]);
+			}
+			CHECK_NULL(gCustomAllocator->allocate(100, 16));
+
+			for (s32 i=0; i<n; ++i)
+				gCustomAllocator->deallocate(mem[i]);
+
+			gCustomAllocator->release();
+		}
+
+		UNITTEST_TEST(concurrent_producers)
+		{
+			// 8 segments of 64 KB shared by 4 producer threads
+			alloc_t* forward = gCreateConcurrentForwardAllocator(gSystemAllocator, 64 * 1024, 8);
+			CHECK_NOT_NULL(forward);
+
+			struct block_t
+			{
+				xbyte*	mPtr;
+				u32		mSize;
+			};
+
+			s32 const	num_threads = 4;
+			s32 const	num_blocks  = 256;
+			block_t		blocks[num_threads * num_blocks];
+			s32			failures[num_threads];
+			std::thread	threads[num_threads];
+
+			// Burst, every producer stamps its blocks with its own byte
+			for (s32 t=0; t<num_threads; ++t)
+			{
+				threads[t] = std::thread([=, &blocks, &failures]() {
+					failures[t] = 0;
+					for (s32 i=0; i<num_blocks; ++i)
+					{
+						u32 const size = 16 + ((i * 7 + t * 13) % 200);
+						xbyte*    p    = (xbyte*)forward->allocate(size, 8);
+						if (p == NULL)
+							++failures[t];
+						else
+							for (u32 b=0; b<size; ++b)
+								p[b] = (xbyte)(t + 1);
+						blocks[t * num_blocks + i].mPtr  = p;
+						blocks[t * num_blocks + i].mSize = size;
+					}
+				});
+			}
+			for (s32 t=0; t<num_threads; ++t)
+			{
+				threads[t].join();
+				CHECK_EQUAL(0, failures[t]);
+			}
+
+			// No two blocks overlap and every block still holds the stamp of its producer
+			std::sort(blocks, blocks + num_threads * num_blocks, [](block_t const& a, block_t const& b) { return a.mPtr < b.mPtr; });
+			s32 overlaps = 0;
+			for (s32 i=1; i<num_threads * num_blocks; ++i)
+				if ((blocks[i - 1].mPtr + blocks[i - 1].mSize) > blocks[i].mPtr)
+					++overlaps;
+			CHECK_EQUAL(0, overlaps);
+			for (s32 t=0; t<num_threads; ++t)
+			{
+				threads[t] = std::thread([=, &blocks, &failures]() {
+					failures[t] = 0;
+					for (s32 i=t; i<num_threads * num_blocks; i+=num_threads)
+					{
+						xbyte const stamp = blocks[i].mPtr[0];
+						for (u32 b=1; b<blocks[i].mSize; ++b)
+							if (blocks[i].mPtr[b] != stamp)
+								++failures[t];
+						forward->deallocate(blocks[i].mPtr);
+					}
+				});
+			}
+			for (s32 t=0; t<num_threads; ++t)
+			{
+				threads[t].join();
+				CHECK_EQUAL(0, failures[t]);
+			}
+
+			// Churn, the producers keep a window of live blocks so segments are sealed and recycled concurrently
+			for (s32 t=0; t<num_threads; ++t)
+			{
+				threads[t] = std::thread([=, &failures]() {
+					failures[t] = 0;
+					block_t window[16];
+					for (s32 i=0; i<16; ++i)
+						window[i].mPtr = NULL;
+					for (s32 i=0; i<20000; ++i)
+					{
+						block_t& slot = window[i & 15];
+						if (slot.mPtr != NULL)
+						{
+							for (u32 b=0; b<slot.mSize; ++b)
+								if (slot.mPtr[b] != (xbyte)(t + 1))
+									++failures[t];
+							forward->deallocate(slot.mPtr);
+						}
+						slot.mSize = 8 + ((i * 31 + t) % 500);
+						slot.mPtr  = (xbyte*)forward->allocate(slot.mSize, 16);
+						if (slot.mPtr == NULL)
+						{
+							++failures[t];
+							continue;
+						}
+						for (u32 b=0; b<slot.mSize; ++b)
+							slot.mPtr[b] = (xbyte)(t + 1);
+					}
+					for (s32 i=0; i<16; ++i)
+						if (window[i].mPtr != NULL)
+							forward->deallocate(window[i].mPtr);
+				});
+			}
+			for (s32 t=0; t<num_threads; ++t)
+			{
+				threads[t].join();
+				CHECK_EQUAL(0, failures[t]);
+			}
+
+			forward->release();
+		}
 	}
 }
 UNITTEST_SUITE_END
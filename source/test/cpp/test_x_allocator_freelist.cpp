@@ -132,6 +132,91 @@ UNITTEST_SUITE_BEGIN(x_allocator_freelist)
 
 			alloc->release();
         }
+
+        UNITTEST_TEST(occupancy)
+        {
+			xoccupancy_t occupancy;
+			fsadexed_t*  alloc = gCreateFreeListIdxAllocator(gSystemAllocator, 16, 8, 300, xfreelist_options_t(FREELIST_POLICY_LIFO, &occupancy));
+			CHECK_TRUE(occupancy.valid());
+			CHECK_EQUAL(300, occupancy.capacity());
+			CHECK_EQUAL(0, occupancy.count());
+			CHECK_FALSE(occupancy.begin() != occupancy.end());
+
+			void* mem[300];
+			for (s32 i = 0; i < 300; ++i)
+				mem[i] = alloc->allocate();
+			for (s32 i = 0; i < 300; ++i)
+			{
+				if ((alloc->ptr2idx(mem[i]) % 3) != 0)
+				{
+					alloc->deallocate(mem[i]);
+					mem[i] = NULL;
+				}
+			}
+			CHECK_EQUAL(100, occupancy.count());
+
+			u32  count = 0;
+			bool valid = true;
+			occupancy.for_each_live([&](u32 idx) { valid = valid && (idx % 3) == 0; ++count; });
+			CHECK_TRUE(valid);
+			CHECK_EQUAL(100, count);
+
+			count = 0;
+			occupancy.for_each_live([&](u32) { ++count; }, 64, 128);
+			CHECK_EQUAL(21, count);
+
+			count = 0;
+			for (u32 chunk = 0; chunk < 3; ++chunk)
+				occupancy.for_each_live_chunk([&](u32) { ++count; }, chunk, 3);
+			CHECK_EQUAL(100, count);
+
+			u32 expected = 0;
+			for (xoccupancy_t::iterator it = occupancy.begin(); it != occupancy.end(); ++it)
+			{
+				CHECK_EQUAL(expected, *it);
+				expected += 3;
+			}
+			CHECK_EQUAL(300, expected);
+
+			for (s32 i = 0; i < 300; ++i)
+				alloc->deallocate(mem[i]);
+			CHECK_EQUAL(0, occupancy.count());
+
+			alloc->release();
+        }
+
+        UNITTEST_TEST(lowest_index_first)
+        {
+			u32 const    count = 5000;
+			xoccupancy_t occupancy;
+			fsadexed_t*  alloc = gCreateFreeListIdxAllocator(gSystemAllocator, 8, 8, count, xfreelist_options_t(FREELIST_POLICY_LOWEST_INDEX_FIRST, &occupancy));
+
+			for (u32 i = 0; i < count; ++i)
+			{
+				void* p = alloc->allocate();
+				CHECK_EQUAL(i, alloc->ptr2idx(p));
+			}
+			CHECK_NULL(alloc->allocate());
+
+			// Free in a scattered order, re-allocation has to return the lowest indices first
+			for (u32 i = 0; i < count; i += 7)
+				alloc->deallocate(alloc->idx2ptr(count - 1 - i));
+			u32 lowest = (count - 1) % 7;
+			for (u32 i = 0; i < count; i += 7)
+			{
+				void* p = alloc->allocate();
+				CHECK_EQUAL(lowest, alloc->ptr2idx(p));
+				lowest += 7;
+			}
+			CHECK_EQUAL(count, occupancy.count());
+
+			for (u32 i = 0; i < count; ++i)
+				alloc->deallocate(alloc->idx2ptr(i));
+			CHECK_EQUAL(0, alloc->ptr2idx(alloc->allocate()));
+			alloc->deallocate(alloc->idx2ptr(0));
+
+			alloc->release();
+        }
 	}
 }
 UNITTEST_SUITE_END
@@ -0,0 +1,99 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_giant.h"
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_allocator_giant)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		UNITTEST_FIXTURE_SETUP()
+		{
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+		}
+
+		UNITTEST_TEST(map_and_unmap)
+		{
+			giant_alloc_t* giant = gCreateGiantAllocator(gSystemAllocator);
+			if (giant == NULL)
+				return;
+
+			// Enough allocations to grow the registry a few times
+			void* mem[200];
+			for (s32 i=0; i<200; ++i)
+			{
+				mem[i] = giant->allocate(64 * 1024 + i, 8);
+				CHECK_NOT_NULL(mem[i]);
+				*(s32*)mem[i] = i;
+			}
+			for (s32 i=0; i<200; ++i)
+			{
+				CHECK_TRUE(giant->owns(mem[i]));
+				CHECK_EQUAL(i, *(s32*)mem[i]);
+			}
+			CHECK_FALSE(giant->owns((xbyte*)mem[0] + 8));
+
+			for (s32 i=0; i<200; i+=2)
+				CHECK_TRUE(giant->deallocate(mem[i]) >= (u32)(64 * 1024 + i));
+			for (s32 i=0; i<200; ++i)
+				CHECK_EQUAL((i & 1) != 0, giant->owns(mem[i]));
+
+			// Aligned
+			void* aligned = giant->allocate(1024 * 1024, 2 * 1024 * 1024);
+			CHECK_EQUAL(0, (s32)((uptr)aligned & (2 * 1024 * 1024 - 1)));
+			giant->deallocate(aligned);
+
+			// Release unmaps what is left
+			giant->release();
+		}
+
+		UNITTEST_TEST(remap)
+		{
+			giant_alloc_t* giant = gCreateGiantAllocator(gSystemAllocator);
+			if (giant == NULL)
+				return;
+
+			u32 const mb = 1024 * 1024;
+			u32* mem = (u32*)giant->allocate(4 * mb, 8);
+			for (u32 i=0; i<mb; i+=1024)
+				mem[i] = i;
+
+			// Something right behind it, so growing has to move the pages
+			void* blocker = giant->allocate(mb, 8);
+
+			u32* grown = (u32*)giant->reallocate(mem, 64 * mb);
+			CHECK_NOT_NULL(grown);
+			CHECK_EQUAL(64 * mb, (u32)giant->size_of(grown));
+			for (u32 i=0; i<mb; i+=1024)
+				CHECK_EQUAL(i, grown[i]);
+			grown[16 * mb - 1] = 1;
+
+			// Shrinking stays in place
+			u32* shrunk = (u32*)giant->reallocate(grown, 2 * mb);
+			CHECK_EQUAL(grown, shrunk);
+			CHECK_EQUAL(2 * mb, (u32)giant->size_of(shrunk));
+
+			// Alignment is kept when the block moves
+			u32* aligned = (u32*)giant->allocate(mb, 4 * mb);
+			aligned[0] = 0x12345678;
+			void* blocker2 = giant->allocate(mb, 8);
+			u32* aligned_grown = (u32*)giant->reallocate(aligned, 32 * mb);
+			CHECK_EQUAL(0, (s32)((uptr)aligned_grown & (4 * mb - 1)));
+			CHECK_EQUAL(0x12345678, aligned_grown[0]);
+
+			giant->deallocate(blocker);
+			giant->deallocate(blocker2);
+			giant->deallocate(shrunk);
+			giant->deallocate(aligned_grown);
+			giant->release();
+		}
+	}
+}
+UNITTEST_SUITE_END
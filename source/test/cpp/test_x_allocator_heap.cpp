@@ -0,0 +1,284 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator.h"
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_allocator_heap)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		void*			gBlock;
+		u32				gBlockSize;
+		alloc_ext_t*	gHeap;
+
+		UNITTEST_FIXTURE_SETUP()
+		{
+			gBlockSize = 32 * 1024 * 1024;
+			gBlock = gSystemAllocator->allocate(gBlockSize, 8);
+			gHeap = gCreateHeapAllocator(gBlock, gBlockSize);
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+			gHeap->release();
+			gSystemAllocator->deallocate(gBlock);
+			gBlock = NULL;
+			gBlockSize = 0;
+		}
+
+		UNITTEST_TEST(size_tiers)
+		{
+			CHECK_NOT_NULL(gHeap);
+
+			// The size that deallocate returns is the size of the slot/run/block of the back-end
+			struct { u32 size; u32 align; u32 block; } const sizes[] = {
+				{ 1, 8, 8 }, { 13, 8, 16 }, { 100, 8, 112 }, { 100, 64, 128 }, { 2000, 8, 2048 },
+				{ 3000, 8, 3072 }, { 200 * 1024, 8, 224 * 1024 }, { 300 * 1024, 8, 512 * 1024 }, { 3000, 65536, 65536 } };
+			for (s32 i=0; i<9; ++i)
+			{
+				void* mem = gHeap->allocate(sizes[i].size, sizes[i].align);
+				CHECK_NOT_NULL(mem);
+				CHECK_EQUAL(0, (s32)((uptr)mem & (sizes[i].align - 1)));
+				CHECK_EQUAL(sizes[i].block, gHeap->usable_size(mem));
+				CHECK_EQUAL(sizes[i].block, gHeap->deallocate(mem));
+			}
+		}
+
+		UNITTEST_TEST(sized_deallocate)
+		{
+			// Same block sizes as the unsized path, from every tier
+			struct { u32 size; u32 align; u32 block; } const sizes[] = {
+				{ 1, 8, 8 }, { 100, 64, 128 }, { 2000, 8, 2048 }, { 3000, 8, 3072 },
+				{ 300 * 1024, 8, 512 * 1024 }, { 3000, 65536, 65536 }, { 40 * 1024 * 1024, 8, 40 * 1024 * 1024 } };
+			void* mem[7][16];
+			for (s32 n=0; n<16; ++n)
+			{
+				for (s32 i=0; i<7; ++i)
+				{
+					mem[i][n] = gHeap->allocate(sizes[i].size, sizes[i].align);
+					CHECK_NOT_NULL(mem[i][n]);
+				}
+			}
+			for (s32 n=0; n<16; ++n)
+			{
+				for (s32 i=0; i<7; ++i)
+					CHECK_EQUAL(sizes[i].block, gHeap->deallocate(mem[i][n], sizes[i].size, sizes[i].align));
+			}
+
+			// Everything merged back, the largest blocks are available again
+			void* large = gHeap->allocate(16 * 1024 * 1024, 8);
+			CHECK_NOT_NULL(large);
+			CHECK_EQUAL(16 * 1024 * 1024, gHeap->deallocate(large, 16 * 1024 * 1024, 8));
+		}
+
+		UNITTEST_TEST(allocate_at_least)
+		{
+			// The size that comes back is the usable size of the block, all of it can be written
+			struct { u32 size; u32 align; u32 block; } const sizes[] = {
+				{ 1, 8, 8 }, { 100, 64, 128 }, { 2000, 8, 2048 }, { 3000, 8, 3072 },
+				{ 300 * 1024, 8, 512 * 1024 }, { 40 * 1024 * 1024 + 1, 8, 40 * 1024 * 1024 + 4096 } };
+			for (s32 i=0; i<6; ++i)
+			{
+				u32 size = 0;
+				xbyte* mem = (xbyte*)gHeap->allocate_at_least(sizes[i].size, sizes[i].align, size);
+				CHECK_NOT_NULL(mem);
+				CHECK_EQUAL(sizes[i].block, size);
+				CHECK_EQUAL(size, gHeap->usable_size(mem));
+				mem[0] = 1;
+				mem[size - 1] = 1;
+				CHECK_EQUAL(sizes[i].block, gHeap->deallocate(mem, size, sizes[i].align));
+			}
+		}
+
+		UNITTEST_TEST(slabs)
+		{
+			// Slots of a slab are next to each other, a slab that runs full is replaced
+			void* mem[2000];
+			for (s32 i=0; i<2000; ++i)
+			{
+				mem[i] = gHeap->allocate(48, 16);
+				CHECK_NOT_NULL(mem[i]);
+			}
+			CHECK_EQUAL((xbyte*)mem[0] + 48, (xbyte*)mem[1]);
+			for (s32 i=0; i<2000; ++i)
+				CHECK_EQUAL(48, gHeap->deallocate(mem[i]));
+		}
+
+		UNITTEST_TEST(random)
+		{
+			void* mem[512];
+			u32 size[512];
+			for (s32 i=0; i<512; ++i)
+				mem[i] = NULL;
+
+			u32 seed = 0x2468ace;
+			for (s32 n=0; n<50000; ++n)
+			{
+				seed = seed * 1664525 + 1013904223;
+				s32 const i = (seed >> 8) & 511;
+				if (mem[i] == NULL)
+				{
+					// Mostly small, some medium and a few large
+					u32 const r = (seed >> 17) & 127;
+					size[i] = r < 100 ? (8 + (seed >> 20) % 2040) : (r < 125 ? (2048 + (seed >> 12) % (256 * 1024)) : (256 * 1024 + (seed >> 8) % (2 * 1024 * 1024)));
+					mem[i] = gHeap->allocate(size[i], 8);
+					if (mem[i] != NULL)
+					{
+						((u32*)mem[i])[0] = size[i];
+						((xbyte*)mem[i])[size[i] - 1] = (xbyte)size[i];
+					}
+				}
+				else
+				{
+					CHECK_EQUAL(size[i], ((u32*)mem[i])[0]);
+					CHECK_EQUAL((xbyte)size[i], ((xbyte*)mem[i])[size[i] - 1]);
+					CHECK_TRUE(gHeap->deallocate(mem[i]) >= size[i]);
+					mem[i] = NULL;
+				}
+			}
+			for (s32 i=0; i<512; ++i)
+				gHeap->deallocate(mem[i]);
+		}
+
+		UNITTEST_TEST(small_blocks)
+		{
+			// A small block drops the tiers that don't fit, the smallest are served by TLSF alone
+			u32 const block_sizes[] = { 8 * 1024, 20000, 64 * 1024, 128 * 1024, 200000, 512 * 1024, 1024 * 1024, 1536 * 1024, 3 * 1024 * 1024 };
+			for (s32 b=0; b<9; ++b)
+			{
+				void* block = gSystemAllocator->allocate(block_sizes[b], 8);
+				alloc_ext_t* heap = gCreateHeapAllocator(block, block_sizes[b]);
+				CHECK_NOT_NULL(heap);
+
+				u32 const sizes[] = { 1, 100, 700, block_sizes[b] / 64, block_sizes[b] / 32 };
+				void* mem[5];
+				for (s32 i=0; i<5; ++i)
+				{
+					mem[i] = heap->allocate(sizes[i], 8);
+					CHECK_NOT_NULL(mem[i]);
+					((xbyte*)mem[i])[0] = 1;
+					((xbyte*)mem[i])[sizes[i] - 1] = 1;
+				}
+				for (s32 i=0; i<5; ++i)
+					CHECK_TRUE(heap->deallocate(mem[i]) >= sizes[i]);
+
+				heap->release();
+				gSystemAllocator->deallocate(block);
+			}
+
+			u64 tiny[8];
+			CHECK_NULL(gCreateHeapAllocator(tiny, sizeof(tiny)));
+		}
+
+		UNITTEST_TEST(sized_deallocate_after_spill)
+		{
+			// No medium tier, fill the slabs until a small size spills to another tier. The small blocks from
+			// before the spill are still slab slots, a sized deallocate must not take them for buddy blocks.
+			u32 const block_size = 896 * 1024;
+			void* block = gSystemAllocator->allocate(block_size, 8);
+			alloc_ext_t* heap = gCreateHeapAllocator(block, block_size);
+			CHECK_NOT_NULL(heap);
+
+			s32 const max_count = 16384;
+			void** mem = (void**)gSystemAllocator->allocate(max_count * sizeof(void*), sizeof(void*));
+			s32 count = 0;
+			bool spilled = false;
+			while (count < max_count && !spilled)
+			{
+				mem[count] = heap->allocate(64, 8);
+				if (mem[count] == NULL)
+					break;
+				spilled = heap->usable_size(mem[count]) != 64;
+				++count;
+			}
+
+			for (s32 i=0; i<count; ++i)
+			{
+				u32 const size = heap->deallocate(mem[i], 64, 8);
+				CHECK_TRUE(size >= 64);
+			}
+
+			// Everything went back to the right place, the slabs can be filled again
+			for (s32 i=0; i<count - 1; ++i)
+			{
+				mem[i] = heap->allocate(64, 8);
+				CHECK_EQUAL(64, heap->usable_size(mem[i]));
+			}
+			for (s32 i=0; i<count - 1; ++i)
+				CHECK_EQUAL(64, heap->deallocate(mem[i], 64, 8));
+
+			gSystemAllocator->deallocate(mem);
+			heap->release();
+			gSystemAllocator->deallocate(block);
+		}
+
+		UNITTEST_TEST(giant)
+		{
+			// Larger than the block, mapped directly when the platform supports it
+			void* mem = gHeap->allocate(64 * 1024 * 1024, 8);
+			if (mem != NULL)
+			{
+				((xbyte*)mem)[64 * 1024 * 1024 - 1] = 1;
+				CHECK_EQUAL(64 * 1024 * 1024, gHeap->usable_size(mem));
+				CHECK_EQUAL(64 * 1024 * 1024, gHeap->deallocate(mem));
+			}
+		}
+
+		UNITTEST_TEST(reallocate)
+		{
+			// A block of the heap moves, the content is kept
+			u32* mem = (u32*)gHeap->allocate(100, 8);
+			CHECK_NOT_NULL(mem);
+			for (u32 i=0; i<25; ++i)
+				mem[i] = i;
+			mem = (u32*)gHeap->reallocate(mem, 200 * 1024, 8);
+			CHECK_NOT_NULL(mem);
+			CHECK_EQUAL(224 * 1024, gHeap->usable_size(mem));
+			for (u32 i=0; i<25; ++i)
+				CHECK_EQUAL(i, mem[i]);
+			mem = (u32*)gHeap->reallocate(mem, 40, 8);
+			CHECK_EQUAL(40, gHeap->usable_size(mem));
+			for (u32 i=0; i<10; ++i)
+				CHECK_EQUAL(i, mem[i]);
+			gHeap->deallocate(mem);
+
+			// A giant block is remapped
+			u32 const mb = 1024 * 1024;
+			u32* giant = (u32*)gHeap->allocate(64 * mb, 8);
+			if (giant == NULL)
+				return;
+			for (u32 i=0; i<16 * mb; i+=4096)
+				giant[i] = i;
+			giant = (u32*)gHeap->reallocate(giant, 128 * mb, 8);
+			CHECK_NOT_NULL(giant);
+			CHECK_EQUAL(128 * mb, gHeap->usable_size(giant));
+			for (u32 i=0; i<16 * mb; i+=4096)
+				CHECK_EQUAL(i, giant[i]);
+			giant[32 * mb - 1] = 1;
+			CHECK_EQUAL(128 * mb, gHeap->deallocate(giant));
+		}
+
+		UNITTEST_TEST(full)
+		{
+			// A full heap continues with giant allocations, the giant registry doesn't need the heap
+			void* giant = gHeap->allocate(64 * 1024 * 1024, 8);
+			if (giant == NULL)
+				return;
+			gHeap->deallocate(giant);
+
+			void* mem[1024];
+			for (s32 i=0; i<1024; ++i)
+			{
+				mem[i] = gHeap->allocate(64 * 1024, 8);
+				CHECK_NOT_NULL(mem[i]);
+			}
+			for (s32 i=0; i<1024; ++i)
+				CHECK_EQUAL(64 * 1024, gHeap->deallocate(mem[i]));
+		}
+	}
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,134 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_medium.h"
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_allocator_medium)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		alloc_ext_t*	gMediumAllocator;
+
+		UNITTEST_FIXTURE_SETUP()
+		{
+			gMediumAllocator = gCreateMediumAllocator(gSystemAllocator, 4 * 1024 * 1024);
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+			gMediumAllocator->release();
+		}
+
+		UNITTEST_TEST(min_size)
+		{
+			// The memory has to hold one run of the largest class
+			CHECK_NULL(gCreateMediumAllocator(gSystemAllocator, 0));
+			CHECK_NULL(gCreateMediumAllocator(gSystemAllocator, 8 * 1024));
+			CHECK_NULL(gCreateMediumAllocator(gSystemAllocator, 256 * 1024 - 1));
+
+			alloc_ext_t* medium = gCreateMediumAllocator(gSystemAllocator, 256 * 1024);
+			CHECK_NOT_NULL(medium);
+			void* mem = medium->allocate(256 * 1024, 8);
+			CHECK_NOT_NULL(mem);
+			CHECK_NULL(medium->allocate(2048, 8));
+			medium->deallocate(mem);
+			mem = medium->allocate(2048, 8);
+			CHECK_NOT_NULL(mem);
+			medium->deallocate(mem);
+			medium->release();
+		}
+
+		UNITTEST_TEST(size_classes)
+		{
+			// Sizes round up to 4 classes per power of 2
+			struct { u32 size; u32 class_size; } const sizes[] = {
+				{ 100, 2048 }, { 2048, 2048 }, { 2049, 2560 }, { 3000, 3072 }, { 4096, 4096 },
+				{ 5000, 5120 }, { 100000, 114688 }, { 256 * 1024, 256 * 1024 } };
+			for (s32 i=0; i<8; ++i)
+			{
+				void* mem = gMediumAllocator->allocate(sizes[i].size, 8);
+				CHECK_NOT_NULL(mem);
+				CHECK_EQUAL(sizes[i].class_size, gMediumAllocator->usable_size(mem));
+				CHECK_EQUAL(sizes[i].class_size, gMediumAllocator->deallocate(mem));
+			}
+
+			CHECK_NULL(gMediumAllocator->allocate(256 * 1024 + 1, 8));
+
+			// Alignment moves up to a class that is aligned
+			void* mem = gMediumAllocator->allocate(2100, 4096);
+			CHECK_EQUAL(0, (s32)((uptr)mem & 4095));
+			CHECK_EQUAL(4096, gMediumAllocator->deallocate(mem));
+		}
+
+		UNITTEST_TEST(runs)
+		{
+			// Slots of a run are next to each other
+			xbyte* mem1 = (xbyte*)gMediumAllocator->allocate(3000, 8);
+			xbyte* mem2 = (xbyte*)gMediumAllocator->allocate(3000, 8);
+			CHECK_EQUAL(mem1 + 3072, mem2);
+			gMediumAllocator->deallocate(mem1);
+			gMediumAllocator->deallocate(mem2);
+
+			// Fill the memory with one class, free it and fill it with another class. The empty run that
+			// a class keeps (16 pages for 3072 and 8192) is given back when the memory runs out.
+			void* mem[1024];
+			s32 n = 0;
+			while (n < 1024 && (mem[n] = gMediumAllocator->allocate(8192, 8)) != NULL)
+				++n;
+			CHECK_EQUAL(1024 / 16 * 8, n);
+			for (s32 i=0; i<n; ++i)
+				gMediumAllocator->deallocate(mem[i]);
+
+			n = 0;
+			while (n < 1024 && (mem[n] = gMediumAllocator->allocate(64 * 1024, 8)) != NULL)
+				++n;
+			CHECK_EQUAL(1024 / 16, n);
+			for (s32 i=0; i<n; ++i)
+				gMediumAllocator->deallocate(mem[i]);
+		}
+
+		UNITTEST_TEST(random)
+		{
+			void* mem[256];
+			u32 size[256];
+			for (s32 i=0; i<256; ++i)
+				mem[i] = NULL;
+
+			u32 seed = 0x7654321;
+			for (s32 n=0; n<20000; ++n)
+			{
+				seed = seed * 1664525 + 1013904223;
+				s32 const i = (seed >> 8) & 255;
+				if (mem[i] == NULL)
+				{
+					size[i] = 2048 + ((seed >> 12) % (64 * 1024));
+					mem[i] = gMediumAllocator->allocate(size[i], 8);
+					if (mem[i] != NULL)
+					{
+						((u32*)mem[i])[0] = size[i];
+						((u32*)((xbyte*)mem[i] + size[i]))[-1] = size[i];
+					}
+				}
+				else
+				{
+					CHECK_EQUAL(size[i], ((u32*)mem[i])[0]);
+					CHECK_EQUAL(size[i], ((u32*)((xbyte*)mem[i] + size[i]))[-1]);
+					CHECK_TRUE(gMediumAllocator->deallocate(mem[i]) >= size[i]);
+					mem[i] = NULL;
+				}
+			}
+			for (s32 i=0; i<256; ++i)
+				gMediumAllocator->deallocate(mem[i]);
+
+			// Everything is free again, except for one empty run per class
+			void* large = gMediumAllocator->allocate(256 * 1024, 8);
+			CHECK_NOT_NULL(large);
+			gMediumAllocator->deallocate(large);
+		}
+	}
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,141 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator_region.h"
+
+#include "xunittest/xunittest.h"
+#include "test_x_counting_allocator.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_allocator_region)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		UNITTEST_FIXTURE_SETUP()
+		{
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+		}
+
+		UNITTEST_TEST(bump_and_recycle)
+		{
+			xcounting_allocator parent(gSystemAllocator);
+			alloc_t* regions = gCreateRegionAllocator(&parent, 4096, 2);
+			CHECK_EQUAL(1, parent.mNumAllocations);
+
+			// Allocations are bumped, no headers
+			xbyte* p1 = (xbyte*)regions->allocate(32, 8);
+			xbyte* p2 = (xbyte*)regions->allocate(32, 8);
+			CHECK_EQUAL(p1 + 32, p2);
+			CHECK_EQUAL(2, parent.mNumAllocations);
+
+			// Too large for a region
+			CHECK_NULL(regions->allocate(4096, 8));
+
+			// Fill a few regions
+			void* mem[100];
+			for (s32 i=0; i<100; ++i)
+			{
+				mem[i] = regions->allocate(200, 16);
+				CHECK_NOT_NULL(mem[i]);
+				CHECK_EQUAL(0, (s32)((uptr)mem[i] & 15));
+			}
+			s32 const peak = parent.mNumAllocations;
+			CHECK_TRUE(peak >= 1 + 5);
+
+			// Freeing is a decrement, full regions are recycled when their count reaches zero
+			CHECK_EQUAL(0, regions->deallocate(p1));
+			regions->deallocate(p2);
+			for (s32 i=0; i<100; ++i)
+				regions->deallocate(mem[i]);
+
+			// Recycled regions are used again, only 2 are cached, the rest went back to the parent
+			for (s32 i=0; i<30; ++i)
+				mem[i] = regions->allocate(200, 16);
+			CHECK_TRUE(parent.mNumAllocations <= 1 + 3);
+			for (s32 i=0; i<30; ++i)
+				regions->deallocate(mem[i]);
+
+			regions->release();
+			CHECK_EQUAL(0, parent.mNumAllocations);
+		}
+
+		UNITTEST_TEST(cross_thread_deallocate)
+		{
+			xcounting_allocator parent(gSystemAllocator);
+			alloc_t* regions = gCreateRegionAllocator(&parent, 4096, 8);
+			CHECK_NULL(regions->allocate(0xfffffff0, 16));
+
+			// 20 allocations of 200 bytes fill a region, 100 allocations fill 5 regions exactly
+			void* mem[100];
+			for (s32 i=0; i<100; ++i)
+				mem[i] = regions->allocate(200, 8);
+			s32 const peak = parent.mNumAllocations;
+			CHECK_EQUAL(1 + 5, peak);
+
+			// Another thread frees everything, the regions are recycled through the lock-free stack
+			std::thread other([&]() {
+				for (s32 i=0; i<100; ++i)
+					regions->deallocate(mem[i]);
+			});
+			other.join();
+
+			// The owner reuses all 5 regions, nothing new is taken from the parent
+			for (s32 i=0; i<100; ++i)
+			{
+				mem[i] = regions->allocate(200, 8);
+				CHECK_NOT_NULL(mem[i]);
+			}
+			CHECK_EQUAL(peak, parent.mNumAllocations);
+			for (s32 i=0; i<100; ++i)
+				regions->deallocate(mem[i]);
+
+			// Concurrent, the owner allocates and stamps blocks while the other thread checks and frees them.
+			// A region that is recycled too early would be handed out again and overwrite a stamp.
+			u32 const				count = 50000;
+			u32**					blocks = (u32**)gSystemAllocator->allocate(count * sizeof(u32*), sizeof(void*));
+			std::atomic<u32>		published(0);
+			s32						errors = 0;
+			std::thread freeing([&]() {
+				for (u32 i=0; i<count; ++i)
+				{
+					while (published.load(std::memory_order_acquire) <= i)
+						std::this_thread::yield();
+					for (u32 w=0; w<16; ++w)
+						if (blocks[i][w] != i)
+							++errors;
+					regions->deallocate(blocks[i]);
+				}
+			});
+			for (u32 i=0; i<count; ++i)
+			{
+				u32* block = (u32*)regions->allocate(16 * sizeof(u32), 8);
+				if (block == NULL)
+					break;
+				for (u32 w=0; w<16; ++w)
+					block[w] = i;
+				blocks[i] = block;
+				published.store(i + 1, std::memory_order_release);
+			}
+			CHECK_EQUAL(count, published.load());
+			freeing.join();
+			CHECK_EQUAL(0, errors);
+			gSystemAllocator->deallocate(blocks);
+
+			// All regions are back, one more region switch recycles them (at most 8 cached, the rest is given back)
+			for (s32 i=0; i<20; ++i)
+				regions->deallocate(regions->allocate(200, 8));
+			CHECK_TRUE(parent.mNumAllocations <= 1 + 1 + 8);
+
+			regions->release();
+			CHECK_EQUAL(0, parent.mNumAllocations);
+		}
+	}
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,166 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_allocator.h"
+#include "xallocator/x_allocator_stl.h"
+#include "xallocator/x_allocator_pmr.h"
+#include "xallocator/x_fsadexed_array.h"
+
+#ifdef X_ALLOCATOR_HAS_PMR
+#include <list>
+#include <vector>
+#endif
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_allocator_stl)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		UNITTEST_FIXTURE_SETUP()
+		{
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+		}
+
+		struct node
+		{
+			node* mNext;
+			u64 mValue;
+		};
+
+		UNITTEST_TEST(stl_allocator)
+		{
+			xstl_allocator_t<u64> a(gSystemAllocator);
+			u64* p = a.allocate(10);
+			CHECK_NOT_NULL(p);
+			CHECK_EQUAL(0, (s32)((uptr)p & (alignof(u64) - 1)));
+			for (s32 i=0; i<10; ++i)
+				p[i] = i;
+			a.deallocate(p, 10);
+
+			xstl::allocation_result_t<u64*> r = a.allocate_at_least(5);
+			CHECK_NOT_NULL(r.ptr);
+			CHECK_TRUE(r.count >= 5);
+			a.deallocate(r.ptr, r.count);
+
+			// Rebinds share the allocator
+			xstl_allocator_t<u64>::rebind<node>::other b(a);
+			CHECK_TRUE(b.allocator() == gSystemAllocator);
+			CHECK_TRUE(a == b);
+			node* n = b.allocate(1);
+			CHECK_NOT_NULL(n);
+			b.deallocate(n, 1);
+
+			// More than an alloc_t can take, the size is not truncated to 32 bits
+			CHECK_EQUAL(0xffffffff / sizeof(u64), a.max_size());
+			CHECK_NULL(a.allocate(a.max_size() + 1));
+			CHECK_NULL(a.allocate_at_least(a.max_size() + 1).ptr);
+		}
+
+		UNITTEST_TEST(stl_allocator_at_least)
+		{
+			u32 const block_size = 4 * 1024 * 1024;
+			void* block = gSystemAllocator->allocate(block_size, 8);
+			alloc_ext_t* heap = gCreateHeapAllocator(block, block_size);
+
+			// 100 bytes is a block of 112, the slack is 3 more objects
+			xstl_allocator_t<u32, alloc_ext_t> a(heap);
+			xstl::allocation_result_t<u32*> r = a.allocate_at_least(25);
+			CHECK_NOT_NULL(r.ptr);
+			CHECK_EQUAL(28, (s32)r.count);
+			r.ptr[27] = 27;
+			a.deallocate(r.ptr, r.count);
+
+			heap->release();
+			gSystemAllocator->deallocate(block);
+		}
+
+		UNITTEST_TEST(stl_pool_allocator)
+		{
+			u32 const size = 16;
+			fsadexed_t* pool = gCreateArrayIdxAllocator(gSystemAllocator, gSystemAllocator, sizeof(node), alignof(node), size);
+
+			// Single nodes come from the pool, arrays from the fallback
+			xstl_pool_allocator_t<node> a(pool, alignof(node), gSystemAllocator);
+			node* n = a.allocate(1);
+			CHECK_NOT_NULL(n);
+			CHECK_TRUE(pool->ptr2idx(n) < size);
+			node* array = a.allocate(4);
+			CHECK_NOT_NULL(array);
+			CHECK_NOT_EQUAL(n, array);
+			a.deallocate(array, 4);
+			a.deallocate(n, 1);
+
+			// A type that doesn't fit in an element goes to the fallback
+			struct big { u64 mData[8]; };
+			xstl_pool_allocator_t<big> b(a);
+			CHECK_TRUE(a == b);
+			big* x = b.allocate(1);
+			CHECK_NOT_NULL(x);
+			b.deallocate(x, 1);
+			CHECK_NULL(b.allocate(b.max_size() + 1));
+
+			pool->release();
+		}
+
+#ifdef X_ALLOCATOR_HAS_PMR
+		UNITTEST_TEST(pmr_resource)
+		{
+			xpmr_resource_t resource(gSystemAllocator);
+			{
+				std::pmr::vector<u32> v(&resource);
+				for (u32 i=0; i<1000; ++i)
+					v.push_back(i);
+				CHECK_EQUAL(999, v[999]);
+			}
+
+			void* p = resource.allocate(100, 64);
+			CHECK_EQUAL(0, (s32)((uptr)p & 63));
+			resource.deallocate(p, 100, 64);
+			CHECK_TRUE(resource.is_equal(resource));
+
+			// A size that doesn't fit in 32 bits is out of memory, not a truncated allocation
+			if (sizeof(std::size_t) > sizeof(u32))
+			{
+				bool thrown = false;
+				try
+				{
+					(void)resource.allocate((std::size_t)0xffffffff + 65, 8);
+				}
+				catch (std::bad_alloc const&)
+				{
+					thrown = true;
+				}
+				CHECK_TRUE(thrown);
+			}
+		}
+
+		UNITTEST_TEST(pmr_pool_resource)
+		{
+			u32 const size = 256;
+			fsadexed_t* pool = gCreateArrayIdxAllocator(gSystemAllocator, gSystemAllocator, 64, 16, size);
+			xpmr_resource_t upstream(gSystemAllocator);
+			xpmr_pool_resource_t resource(pool, 16, &upstream);
+			{
+				// The nodes of a list fit in the elements of the pool
+				std::pmr::list<u32> l(&resource);
+				for (u32 i=0; i<100; ++i)
+					l.push_back(i);
+				CHECK_TRUE(pool->ptr2idx(&l.front()) < size);
+				CHECK_EQUAL(99, l.back());
+			}
+
+			void* p = resource.allocate(1000, 8);
+			CHECK_NOT_NULL(p);
+			resource.deallocate(p, 1000, 8);
+			pool->release();
+		}
+#endif
+	}
+}
+UNITTEST_SUITE_END
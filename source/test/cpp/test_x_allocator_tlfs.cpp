@@ -2,12 +2,12 @@
 #include "xallocator/x_allocator_tlsf.h"
 
 #include "xunittest/xunittest.h"
+#include "test_x_counting_allocator.h"
 
 using namespace xcore;
 
 extern alloc_t* gSystemAllocator;
 
-
 UNITTEST_SUITE_BEGIN(x_allocator_tlfs)
 {
     UNITTEST_FIXTURE(main)
@@ -15,7 +15,7 @@ UNITTEST_SUITE_BEGIN(x_allocator_tlfs)
 
 		void*			gBlock;
 		s32				gBlockSize;
-		alloc_t*	gCustomAllocator;
+		alloc_ext_t*	gCustomAllocator;
 
         UNITTEST_FIXTURE_SETUP()
 		{
@@ -42,6 +42,192 @@ UNITTEST_SUITE_BEGIN(x_allocator_tlfs)
 			gCustomAllocator->deallocate(mem3);
         }
 
+        UNITTEST_TEST(allocate_at_least)
+        {
+			// The block is at least the size that was asked for, it is what deallocate returns
+			u32 size = 0;
+			void* mem = gCustomAllocator->allocate_at_least(500, 8, size);
+			CHECK_NOT_NULL(mem);
+			CHECK_TRUE(size >= 500);
+			CHECK_EQUAL(size, gCustomAllocator->usable_size(mem));
+			CHECK_EQUAL(size, gCustomAllocator->deallocate(mem));
+        }
+
+        UNITTEST_TEST(fit_policies)
+        {
+			// Blocks of 1048 (A) and 1032 (B) bytes are free, both in the size class of a 1032 byte request
+			u32 const block_size = 64 * 1024;
+			void* block = gSystemAllocator->allocate(block_size, 8);
+			ETlsfFit const fits[] = { TLSF_FIT_GOOD, TLSF_FIT_BEST, TLSF_FIT_ADDRESS };
+			for (s32 f=0; f<3; ++f)
+			{
+				alloc_ext_t* tlsf = gCreateTlsfAllocator(block, block_size, fits[f]);
+				void* a = tlsf->allocate(1048, 8);
+				void* s1 = tlsf->allocate(16, 8);
+				void* b = tlsf->allocate(1032, 8);
+				void* s2 = tlsf->allocate(16, 8);
+				tlsf->deallocate(a);
+				tlsf->deallocate(b);
+
+				// Good-fit rounds up to the next class, best-fit takes the exact block and address-ordered the lowest
+				void* c = tlsf->allocate(1032, 8);
+				CHECK_NOT_NULL(c);
+				if (fits[f] == TLSF_FIT_GOOD)
+					CHECK_TRUE(c != a && c != b);
+				else if (fits[f] == TLSF_FIT_BEST)
+					CHECK_EQUAL(b, c);
+				else
+					CHECK_EQUAL(a, c);
+
+				tlsf->deallocate(c);
+				tlsf->deallocate(s1);
+				tlsf->deallocate(s2);
+				tlsf->release();
+			}
+			gSystemAllocator->deallocate(block);
+        }
+
+        UNITTEST_TEST(aligned_reuse)
+        {
+			// Aligned blocks with a block in between that leaves only a small gap, so that they can't merge
+			void* aligned[64];
+			void* separator[64];
+			for (s32 i=0; i<64; ++i)
+			{
+				aligned[i] = gCustomAllocator->allocate(4096, 4096);
+				CHECK_NOT_NULL(aligned[i]);
+				CHECK_EQUAL(0, (s32)((uptr)aligned[i] & 4095));
+				separator[i] = gCustomAllocator->allocate(4096 - 64, 8);
+			}
+
+			// The holes are not large enough for an over-allocated request, they are placed right though
+			xbyte* highest = NULL;
+			for (s32 i=0; i<64; ++i)
+			{
+				highest = (xbyte*)aligned[i] > highest ? (xbyte*)aligned[i] : highest;
+				gCustomAllocator->deallocate(aligned[i]);
+			}
+			for (s32 i=0; i<64; ++i)
+			{
+				aligned[i] = gCustomAllocator->allocate(4096, 4096);
+				CHECK_NOT_NULL(aligned[i]);
+				CHECK_EQUAL(0, (s32)((uptr)aligned[i] & 4095));
+				CHECK_TRUE((xbyte*)aligned[i] <= highest);
+			}
+
+			for (s32 i=0; i<64; ++i)
+			{
+				gCustomAllocator->deallocate(aligned[i]);
+				gCustomAllocator->deallocate(separator[i]);
+			}
+
+			// 64 byte alignment, every block is checked for alignment and size
+			void* simd[256];
+			for (s32 i=0; i<256; ++i)
+			{
+				u32 const size = 64 + (i % 7) * 48;
+				simd[i] = gCustomAllocator->allocate(size, 64);
+				CHECK_NOT_NULL(simd[i]);
+				CHECK_EQUAL(0, (s32)((uptr)simd[i] & 63));
+				CHECK_TRUE(gCustomAllocator->usable_size(simd[i]) >= size);
+				if ((i & 1) == 1)
+				{
+					gCustomAllocator->deallocate(simd[i - 1]);
+					simd[i - 1] = NULL;
+				}
+			}
+			for (s32 i=0; i<256; ++i)
+				gCustomAllocator->deallocate(simd[i]);
+        }
+
+		UNITTEST_TEST(heap_grow)
+		{
+			xcounting_allocator parent(gSystemAllocator);
+			tlsf_heap_t* heap = gCreateTlsfHeap(&parent, 64 * 1024);
+			CHECK_NOT_NULL(heap);
+			CHECK_EQUAL(1, parent.mNumAllocations);
+
+			// Pools are added when needed
+			void* mem[64];
+			for (s32 i=0; i<64; ++i)
+			{
+				mem[i] = heap->allocate(4096, 8);
+				CHECK_NOT_NULL(mem[i]);
+			}
+			CHECK_TRUE(parent.mNumAllocations > 4);
+
+			// Larger than a pool and aligned
+			void* large = heap->allocate(1024 * 1024, 256);
+			CHECK_NOT_NULL(large);
+			CHECK_EQUAL(0, (s32)((uptr)large & 255));
+
+			tlsf_heap_t::stats_t stats;
+			heap->get_stats(stats);
+			CHECK_EQUAL(1, (s32)stats.mHeaps);
+			CHECK_EQUAL(parent.mNumAllocations - 1, (s32)stats.mPools);
+			CHECK_TRUE(stats.mUsed >= (64 * 4096 + 1024 * 1024));
+			CHECK_TRUE(stats.mReserved >= stats.mUsed);
+
+			for (s32 i=0; i<64; ++i)
+				heap->deallocate(mem[i]);
+			heap->deallocate(large);
+			heap->get_stats(stats);
+			CHECK_EQUAL(0, (s32)stats.mUsed);
+
+			heap->release();
+			CHECK_EQUAL(0, parent.mNumAllocations);
+		}
+
+		UNITTEST_TEST(heap_children)
+		{
+			xcounting_allocator parent(gSystemAllocator);
+			tlsf_heap_t* root = gCreateTlsfHeap(&parent, 64 * 1024);
+			tlsf_heap_t* child1 = root->create_child(16 * 1024);
+			tlsf_heap_t* child2 = root->create_child(16 * 1024);
+			tlsf_heap_t* grandchild = child1->create_child(4 * 1024);
+			CHECK_NOT_NULL(child1);
+			CHECK_NOT_NULL(child2);
+			CHECK_NOT_NULL(grandchild);
+
+			// Every heap needs exactly one pool. The children take theirs from the parent heap, the parent
+			// allocator only holds the root heap object and the one pool of the root.
+			for (s32 i=0; i<10; ++i)
+			{
+				CHECK_NOT_NULL(child1->allocate(100, 8));
+				CHECK_NOT_NULL(child2->allocate(200, 8));
+				CHECK_NOT_NULL(grandchild->allocate(300, 8));
+			}
+			CHECK_EQUAL(2, parent.mNumAllocations);
+
+			// Numbers roll up, child pools and heap objects are not counted as used
+			void* mem = root->allocate(1000, 8);
+			tlsf_heap_t::stats_t stats;
+			root->get_stats(stats);
+			CHECK_EQUAL(4, (s32)stats.mHeaps);
+			CHECK_EQUAL(4, (s32)stats.mPools);
+			CHECK_TRUE(stats.mUsed >= (10 * (100 + 200 + 300) + 1000));
+			CHECK_TRUE(stats.mUsed < (10 * (100 + 200 + 300 + 64) + 1000 + 64));
+
+			tlsf_heap_t::stats_t child_stats;
+			child1->get_stats(child_stats);
+			CHECK_EQUAL(2, (s32)child_stats.mHeaps);
+			CHECK_EQUAL(2, (s32)child_stats.mPools);
+			CHECK_TRUE(child_stats.mUsed >= (10 * (100 + 300)));
+
+			// Releasing a child gives its pool back to the parent heap, not to the parent allocator
+			child2->release();
+			root->get_stats(stats);
+			CHECK_EQUAL(3, (s32)stats.mHeaps);
+			CHECK_EQUAL(3, (s32)stats.mPools);
+			CHECK_TRUE(stats.mUsed < (10 * (100 + 300 + 64) + 1000 + 64));
+			CHECK_EQUAL(2, parent.mNumAllocations);
+
+			// Releasing the root destroys the remaining children without visiting their allocations
+			root->deallocate(mem);
+			root->release();
+			CHECK_EQUAL(0, parent.mNumAllocations);
+		}
+
 	}
 }
 UNITTEST_SUITE_END
@@ -0,0 +1,252 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_forward_ring.h"
+
+#include "xunittest/xunittest.h"
+
+#include <thread>
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+namespace
+{
+	// Producer thread writes @count messages of varying size, the calling thread consumes and verifies them
+	static s32 ring_producer_consumer(forward_ring_t* ring, u32 count)
+	{
+		std::thread producer([=]() {
+			for (u32 i=0; i<count; ++i)
+			{
+				u32 const size = 4 + (i % 61) * 4;
+				u32* msg;
+				while ((msg = (u32*)ring->allocate(size)) == NULL)
+					std::this_thread::yield();
+				for (u32 w=0; w<size / 4; ++w)
+					msg[w] = i + w;
+				ring->publish();
+			}
+		});
+
+		s32 errors = 0;
+		for (u32 i=0; i<count; ++i)
+		{
+			u32  size;
+			u32* msg;
+			while ((msg = (u32*)ring->peek(size)) == NULL)
+				std::this_thread::yield();
+			if (size != 4 + (i % 61) * 4)
+				++errors;
+			for (u32 w=0; w<size / 4; ++w)
+				if (msg[w] != i + w)
+					++errors;
+			ring->deallocate();
+		}
+
+		producer.join();
+		return errors;
+	}
+}
+
+UNITTEST_SUITE_BEGIN(x_forward_ring)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		UNITTEST_FIXTURE_SETUP()
+		{
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+		}
+
+		UNITTEST_TEST(fifo)
+		{
+			forward_ring_t* ring = gCreateForwardRing(gSystemAllocator, 1000);
+			CHECK_EQUAL(1024, ring->capacity());
+
+			u32 size;
+			CHECK_NULL(ring->peek(size));
+
+			for (u32 i=0; i<4; ++i)
+			{
+				u32* msg = (u32*)ring->allocate(4 + i * 4);
+				CHECK_NOT_NULL(msg);
+				msg[0] = i;
+			}
+
+			// Nothing is visible until published
+			CHECK_NULL(ring->peek(size));
+			ring->publish();
+
+			for (u32 i=0; i<4; ++i)
+			{
+				u32* msg = (u32*)ring->peek(size);
+				CHECK_NOT_NULL(msg);
+				CHECK_EQUAL(4 + i * 4, size);
+				CHECK_EQUAL(i, msg[0]);
+				ring->deallocate();
+			}
+			CHECK_NULL(ring->peek(size));
+
+			ring->release();
+		}
+
+		UNITTEST_TEST(wrap_around)
+		{
+			forward_ring_t* ring = gCreateForwardRing(gSystemAllocator, 1024);
+
+			// Records of 8 + 100 -> 112 bytes, the ring is full after 9 of them
+			u32 written = 0;
+			u32 read = 0;
+			for (s32 i=0; i<9; ++i)
+			{
+				u32* msg = (u32*)ring->allocate(100);
+				CHECK_NOT_NULL(msg);
+				msg[0] = written++;
+			}
+			CHECK_NULL(ring->allocate(100));
+			ring->publish();
+
+			// Sizes that don't fit, also those where size + header would wrap around
+			CHECK_NULL(ring->allocate(1024 - 7));
+			CHECK_NULL(ring->allocate(0xfffffff8));
+			CHECK_NULL(ring->allocate(0xffffffff));
+
+			// Keep the ring busy so that messages wrap around many times
+			u32 size;
+			for (s32 i=0; i<1000; ++i)
+			{
+				u32* msg = (u32*)ring->peek(size);
+				CHECK_NOT_NULL(msg);
+				CHECK_EQUAL(read++, msg[0]);
+				ring->deallocate();
+
+				u32 const msg_size = 40 + (u32)(i % 7) * 16;
+				while ((msg = (u32*)ring->allocate(msg_size)) == NULL)
+				{
+					msg = (u32*)ring->peek(size);
+					CHECK_NOT_NULL(msg);
+					CHECK_EQUAL(read++, msg[0]);
+					ring->deallocate();
+				}
+				msg[0] = written++;
+				ring->publish();
+			}
+
+			u32* msg;
+			while ((msg = (u32*)ring->peek(size)) != NULL)
+			{
+				CHECK_EQUAL(read++, msg[0]);
+				ring->deallocate();
+			}
+			CHECK_EQUAL(written, read);
+
+			ring->release();
+		}
+
+		UNITTEST_TEST(large_after_wrap)
+		{
+			forward_ring_t* ring = gCreateForwardRing(gSystemAllocator, 1024);
+
+			// The write offset is at 408, a message of 700 bytes doesn't fit in the tail and the tail and the
+			// message together don't fit in the ring. The wrap marker is published on its own, once the
+			// consumer stepped over it the message goes to the start of the (empty) ring.
+			u32 size;
+			CHECK_NOT_NULL(ring->allocate(400));
+			ring->publish();
+			CHECK_NOT_NULL(ring->peek(size));
+			ring->deallocate();
+
+			u32* msg = NULL;
+			s32 tries = 0;
+			while (tries < 1000 && (msg = (u32*)ring->allocate(700)) == NULL)
+			{
+				CHECK_NULL(ring->peek(size));
+				++tries;
+			}
+			CHECK_NOT_NULL(msg);
+			CHECK_EQUAL(1, tries);
+			msg[0] = 0x700;
+			ring->publish();
+
+			msg = (u32*)ring->peek(size);
+			CHECK_NOT_NULL(msg);
+			CHECK_EQUAL(700, size);
+			CHECK_EQUAL(0x700, msg[0]);
+			ring->deallocate();
+			CHECK_NULL(ring->peek(size));
+
+			ring->release();
+		}
+
+		UNITTEST_TEST(mirrored)
+		{
+			forward_ring_t* ring = gCreateMirroredForwardRing(gSystemAllocator, 4096);
+			if (ring == NULL)
+				return;	// Not supported on this platform
+			CHECK_TRUE(ring->mirrored());
+
+			u32 const capacity = ring->capacity();
+			u32 const msg_size = capacity / 4 + 96;
+			u32 const record   = msg_size + 8;
+
+			// Fill the ring with 3 messages, free 2 and allocate 2 more, the first of those straddles the end
+			xbyte* msgs[5];
+			for (u32 i=0; i<5; ++i)
+			{
+				if (i == 3)
+				{
+					u32 size;
+					for (s32 j=0; j<2; ++j)
+					{
+						CHECK_NOT_NULL(ring->peek(size));
+						ring->deallocate();
+					}
+				}
+				msgs[i] = (xbyte*)ring->allocate(msg_size);
+				CHECK_NOT_NULL(msgs[i]);
+				for (u32 b=0; b<msg_size; ++b)
+					msgs[i][b] = (xbyte)(i + b);
+				ring->publish();
+			}
+			CHECK_NULL(ring->allocate(msg_size));
+
+			// The message crossing the end wasn't moved to the start, the one after it continues at the start
+			CHECK_EQUAL(msgs[2] + record, msgs[3]);
+			CHECK_EQUAL(msgs[3] + record - capacity, msgs[4]);
+
+			u32 size;
+			for (u32 i=2; i<5; ++i)
+			{
+				xbyte* msg = (xbyte*)ring->peek(size);
+				CHECK_EQUAL(msgs[i], msg);
+				CHECK_EQUAL(msg_size, size);
+				bool ok = true;
+				for (u32 b=0; b<size; ++b)
+					ok = ok && (msg[b] == (xbyte)(i + b));
+				CHECK_TRUE(ok);
+				ring->deallocate();
+			}
+			CHECK_NULL(ring->peek(size));
+
+			ring->release();
+		}
+
+		UNITTEST_TEST(two_threads)
+		{
+			forward_ring_t* ring = gCreateForwardRing(gSystemAllocator, 4096);
+			u32 size;
+			CHECK_EQUAL(0, ring_producer_consumer(ring, 100000));
+			CHECK_NULL(ring->peek(size));
+			ring->release();
+
+			ring = gCreateMirroredForwardRing(gSystemAllocator, 4096);
+			if (ring == NULL)
+				return;	// Not supported on this platform
+			CHECK_EQUAL(0, ring_producer_consumer(ring, 100000));
+			CHECK_NULL(ring->peek(size));
+			ring->release();
+		}
+	}
+}
+UNITTEST_SUITE_END
@@ -28,7 +28,7 @@ UNITTEST_SUITE_BEGIN(x_fsadexed_array)
 		UNITTEST_TEST(array)
 		{
 			u32 size = 64;
-			fsadexed_t* allocator = gCreateFreeListIdxAllocator(gSystemAllocator, gSystemAllocator, sizeof(object), 8, size);
+			fsadexed_t* allocator = gCreateArrayIdxAllocator(gSystemAllocator, gSystemAllocator, sizeof(object), 8, size);
 
 			for (u32 i=0; i<size; ++i)
 			{
@@ -61,6 +61,50 @@ UNITTEST_SUITE_BEGIN(x_fsadexed_array)
 
 			allocator->release();
 		}
+
+		UNITTEST_TEST(compact_index_width)
+		{
+			CHECK_EQUAL(2, sizeof(xidx16_t));
+			CHECK_EQUAL(3, sizeof(xidx24_t));
+
+			xidx16_t nill16;
+			xidx24_t nill24;
+			CHECK_EQUAL(0xffffffff, (u32)nill16);
+			CHECK_EQUAL(0xffffffff, (u32)nill24);
+			CHECK_EQUAL(0x1234, (u32)xidx16_t(0x1234));
+			CHECK_EQUAL(0x123456, (u32)xidx24_t(0x123456));
+
+			EIndexWidth const widths[] = { INDEX_WIDTH_16, INDEX_WIDTH_24 };
+			for (s32 w=0; w<2; ++w)
+			{
+				// 3 byte objects, 16-bit links are 2 byte aligned (stride 4), 24-bit links have no padding (stride 3)
+				u32 const size   = 300;
+				u32 const stride = (widths[w] == INDEX_WIDTH_16) ? 4 : 3;
+				// 16-bit links are read as u16, so the storage has to be 2 byte aligned
+				u16 storage[2 * 300];
+				xbyte* array = (xbyte*)storage;
+				fsadexed_t* allocator = gCreateArrayIdxAllocator(gSystemAllocator, storage, 3, 1, size, widths[w]);
+
+				for (u32 i=0; i<size; ++i)
+				{
+					void* obj_mem = allocator->allocate();
+					CHECK_EQUAL(array + (i * stride), (xbyte*)obj_mem);
+					CHECK_EQUAL(i, allocator->ptr2idx(obj_mem));
+				}
+				CHECK_NULL(allocator->allocate());
+
+				// Free every other object, they come back in LIFO order
+				for (u32 i=0; i<size; i+=2)
+					allocator->deallocate(allocator->idx2ptr(i));
+				for (s32 i=size-2; i>=0; i-=2)
+					CHECK_EQUAL((u32)i, allocator->ptr2idx(allocator->allocate()));
+				CHECK_NULL(allocator->allocate());
+
+				for (u32 i=0; i<size; ++i)
+					allocator->deallocate(allocator->idx2ptr(i));
+				allocator->release();
+			}
+		}
 	}
 }
 UNITTEST_SUITE_END
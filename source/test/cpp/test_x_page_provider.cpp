@@ -0,0 +1,237 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_page_provider.h"
+#include "xallocator/x_allocator_tlsf.h"
+#include "xallocator/x_allocator_dlmalloc.h"
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+namespace
+{
+	// Counts the live reservations of the provider it wraps
+	class xcounting_page_provider : public page_provider_t
+	{
+	public:
+		xcounting_page_provider(page_provider_t* pages) : mPages(pages), mNumReserved(0) {}
+
+		page_provider_t*	mPages;
+		s32					mNumReserved;
+
+	protected:
+		virtual u32		v_page_size() const						{ return mPages->page_size(); }
+		virtual void*	v_reserve(u64 size, u64 alignment)
+		{
+			void* ptr = mPages->reserve(size, alignment);
+			if (ptr != NULL)
+				++mNumReserved;
+			return ptr;
+		}
+		virtual bool	v_commit(void* addr, u64 size)			{ return mPages->commit(addr, size); }
+		virtual void	v_decommit(void* addr, u64 size)		{ mPages->decommit(addr, size); }
+		virtual void	v_release(void* addr, u64 size)			{ --mNumReserved; mPages->release(addr, size); }
+		virtual void	v_destroy()								{ mPages->destroy(); }
+	};
+}
+
+UNITTEST_SUITE_BEGIN(x_page_provider)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		UNITTEST_FIXTURE_SETUP()
+		{
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+		}
+
+		UNITTEST_TEST(static_buffer)
+		{
+			u32 const size = 64 * 1024;
+			void* block = gSystemAllocator->allocate(size, 4096);
+			page_provider_t* pages = gCreateStaticPageProvider(gSystemAllocator, block, size, 4096);
+			CHECK_EQUAL(4096, (s32)pages->page_size());
+
+			xbyte* p1 = (xbyte*)pages->reserve(8192, 4096);
+			xbyte* p2 = (xbyte*)pages->reserve(4096, 4096);
+			CHECK_EQUAL((xbyte*)block, p1);
+			CHECK_EQUAL(p1 + 8192, p2);
+			CHECK_TRUE(pages->commit(p2, 4096));
+			p2[0] = 1;
+			p2[4095] = 2;
+
+			// Aligned, and too large
+			xbyte* p3 = (xbyte*)pages->reserve(4096, 16384);
+			CHECK_EQUAL(0, (s32)((uptr)p3 & 16383));
+			CHECK_NULL(pages->reserve(size, 4096));
+
+			// Released in stack order the space is reused
+			pages->release(p3, 4096);
+			pages->release(p2, 4096);
+			CHECK_EQUAL(p2, (xbyte*)pages->reserve(4096, 4096));
+
+			pages->destroy();
+			gSystemAllocator->deallocate(block);
+		}
+
+		UNITTEST_TEST(virtual_memory)
+		{
+			page_provider_t* pages = gCreateVirtualPageProvider(gSystemAllocator, PAGES_PREFAULT);
+			if (pages == NULL)
+				return;
+
+			u32 const page = pages->page_size();
+			xbyte* mem = (xbyte*)pages->reserve(1024 * 1024, 256 * 1024);
+			CHECK_NOT_NULL(mem);
+			CHECK_EQUAL(0, (s32)((uptr)mem & (256 * 1024 - 1)));
+
+			// Commit part of it, use it, decommit and commit again
+			CHECK_TRUE(pages->commit(mem + page, 4 * page));
+			mem[page] = 1;
+			mem[5 * page - 1] = 2;
+			pages->decommit(mem + page, 4 * page);
+			CHECK_TRUE(pages->commit(mem + page, 4 * page));
+			CHECK_EQUAL(0, (s32)mem[page]);
+
+			pages->release(mem, 1024 * 1024);
+			pages->destroy();
+		}
+
+		UNITTEST_TEST(memfd)
+		{
+			page_provider_t* pages = gCreateMemfdPageProvider(gSystemAllocator, PAGES_DEFAULT);
+			if (pages == NULL)
+				return;
+
+			u32 const page = pages->page_size();
+			xbyte* mem1 = (xbyte*)pages->reserve(16 * page, page);
+			xbyte* mem2 = (xbyte*)pages->reserve(16 * page, page);
+			CHECK_NOT_NULL(mem1);
+			CHECK_NOT_NULL(mem2);
+			CHECK_TRUE(pages->commit(mem1, 16 * page));
+			CHECK_TRUE(pages->commit(mem2, 16 * page));
+			for (u32 i=0; i<16 * page; ++i)
+			{
+				mem1[i] = 1;
+				mem2[i] = 2;
+			}
+			CHECK_EQUAL(1, (s32)mem1[16 * page - 1]);
+
+			pages->decommit(mem1, 8 * page);
+			CHECK_TRUE(pages->commit(mem1, 8 * page));
+			CHECK_EQUAL(0, (s32)mem1[0]);
+			CHECK_EQUAL(1, (s32)mem1[8 * page]);
+			CHECK_EQUAL(2, (s32)mem2[0]);
+
+			// A new reservation reuses the file range of a released one, the content is gone
+			pages->release(mem1, 16 * page);
+			xbyte* mem3 = (xbyte*)pages->reserve(8 * page, page);
+			xbyte* mem4 = (xbyte*)pages->reserve(8 * page, page);
+			CHECK_NOT_NULL(mem3);
+			CHECK_NOT_NULL(mem4);
+			CHECK_TRUE(pages->commit(mem3, 8 * page));
+			CHECK_TRUE(pages->commit(mem4, 8 * page));
+			CHECK_EQUAL(0, (s32)mem3[0]);
+			CHECK_EQUAL(0, (s32)mem4[8 * page - 1]);
+			mem3[0] = 3;
+			mem4[0] = 4;
+			CHECK_EQUAL(2, (s32)mem2[0]);
+			CHECK_EQUAL(2, (s32)mem2[16 * page - 1]);
+			CHECK_EQUAL(3, (s32)mem3[0]);
+
+			pages->release(mem2, 16 * page);
+			pages->release(mem3, 8 * page);
+			pages->release(mem4, 8 * page);
+			pages->destroy();
+		}
+
+		UNITTEST_TEST(huge_pages)
+		{
+			// The system may not have any huge pages, then a reserve fails
+			page_provider_t* pages = gCreateHugePageProvider(gSystemAllocator, PAGES_DEFAULT);
+			if (pages == NULL)
+				return;
+
+			u32 const page = pages->page_size();
+			xbyte* mem = (xbyte*)pages->reserve(2 * page, page);
+			if (mem != NULL)
+			{
+				CHECK_EQUAL(0, (s32)((uptr)mem & (page - 1)));
+				pages->release(mem, 2 * page);
+			}
+			pages->destroy();
+		}
+
+		UNITTEST_TEST(page_allocator)
+		{
+			u32 const size = 1024 * 1024;
+			void* block = gSystemAllocator->allocate(size, 4096);
+			page_provider_t* pages = gCreateStaticPageProvider(gSystemAllocator, block, size, 4096);
+			alloc_t* allocator = gCreatePageAllocator(gSystemAllocator, pages);
+
+			xbyte* p1 = (xbyte*)allocator->allocate(10000, 8);
+			xbyte* p2 = (xbyte*)allocator->allocate(4096, 65536);
+			CHECK_NOT_NULL(p1);
+			CHECK_NOT_NULL(p2);
+			CHECK_EQUAL(0, (s32)((uptr)p1 & 4095));
+			CHECK_EQUAL(0, (s32)((uptr)p2 & 65535));
+			CHECK_EQUAL(4096, (s32)allocator->deallocate(p2));
+			CHECK_EQUAL(12288, (s32)allocator->deallocate(p1));
+
+			// A heap on top of the provider
+			tlsf_heap_t* heap = gCreateTlsfHeap(allocator, 64 * 1024);
+			for (s32 i=0; i<32; ++i)
+				CHECK_NOT_NULL(heap->allocate(8 * 1024, 8));
+			heap->release();
+
+			allocator->release();
+			pages->destroy();
+			gSystemAllocator->deallocate(block);
+		}
+
+		// dlmalloc keeps its sizes and pointers in 32 bits (msize_t), like its own test suite this only runs on
+		// 32-bit targets
+#ifndef PLATFORM_64BIT
+		UNITTEST_TEST(dlmalloc_segments)
+		{
+			u32 const size = 1024 * 1024;
+			void* block = gSystemAllocator->allocate(size, 4096);
+			xcounting_page_provider pages(gCreateStaticPageProvider(gSystemAllocator, block, size, 4096));
+
+			// The first segment is taken right away
+			alloc_ext_t* heap = gCreateDlAllocator(gSystemAllocator, &pages, 64 * 1024);
+			CHECK_NOT_NULL(heap);
+			CHECK_EQUAL(1, pages.mNumReserved);
+
+			// 256 KB does not fit in one segment, more segments are taken from the provider
+			xbyte* mem[128];
+			for (s32 i=0; i<128; ++i)
+			{
+				mem[i] = (xbyte*)heap->allocate(2000, 8);
+				CHECK_NOT_NULL(mem[i]);
+				mem[i][0] = (xbyte)i;
+				mem[i][1999] = (xbyte)i;
+			}
+			CHECK_TRUE(pages.mNumReserved > 1);
+
+			bool intact = true;
+			for (s32 i=0; i<128; ++i)
+				intact = intact && mem[i][0] == (xbyte)i && mem[i][1999] == (xbyte)i;
+			CHECK_TRUE(intact);
+			for (s32 i=0; i<128; ++i)
+				heap->deallocate(mem[i]);
+
+			// Releasing the heap gives every segment back
+			heap->release();
+			CHECK_EQUAL(0, pages.mNumReserved);
+
+			pages.destroy();
+			gSystemAllocator->deallocate(block);
+		}
+#endif
+	}
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,98 @@
+#include "xbase/x_allocator.h"
+#include "xallocator/x_pool.h"
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_pool)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_FIXTURE_SETUP()
+		{
+		}
+
+        UNITTEST_FIXTURE_TEARDOWN()
+		{
+		}
+
+		static s32 sNumLive = 0;
+
+		struct object
+		{
+			object(u32 a, u32 b) : mA(a), mB(b), mC(a + b) { ++sNumLive; }
+			~object() { --sNumLive; }
+			u32 mA, mB, mC;
+		};
+
+        UNITTEST_TEST(embedded)
+        {
+			xpool_t<object, 32> pool;
+			CHECK_TRUE(pool.empty());
+
+			object* objects[32];
+			for (u32 i = 0; i < 32; ++i)
+			{
+				objects[i] = pool.construct(i, 1);
+				CHECK_NOT_NULL(objects[i]);
+				CHECK_EQUAL(i, pool.idx_of(objects[i]));
+				CHECK_EQUAL(objects[i], pool.ptr_of(i));
+			}
+			CHECK_TRUE(pool.full());
+			CHECK_NULL(pool.construct(0, 0));
+			CHECK_EQUAL(32, sNumLive);
+
+			pool.destroy(objects[5]);
+			pool.destroy(objects[17]);
+			CHECK_EQUAL(30, pool.size());
+
+			// LIFO reuse of the freed slots
+			object* o = pool.construct(100, 200);
+			CHECK_EQUAL(17, pool.idx_of(o));
+			CHECK_EQUAL(300, o->mC);
+			objects[17] = o;
+			objects[5]  = NULL;
+
+			for (u32 i = 0; i < 32; ++i)
+				pool.destroy(objects[i]);
+			CHECK_TRUE(pool.empty());
+			CHECK_EQUAL(0, sNumLive);
+        }
+
+        UNITTEST_TEST(allocated)
+        {
+			xpool_t<object> pool;
+			pool.init(gSystemAllocator, 1000);
+			CHECK_EQUAL(1000, pool.capacity());
+
+			for (u32 i = 0; i < 1000; ++i)
+			{
+				object* o = pool.construct(i, i);
+				CHECK_EQUAL(i, pool.idx_of(o));
+			}
+			CHECK_NULL(pool.allocate());
+
+			for (u32 i = 0; i < 1000; i += 2)
+				pool.destroy(pool.ptr_of(i));
+			CHECK_EQUAL(500, pool.size());
+			for (u32 i = 1; i < 1000; i += 2)
+				CHECK_EQUAL(i * 2, pool.ptr_of(i)->mC);
+			for (u32 i = 1; i < 1000; i += 2)
+				pool.destroy(pool.ptr_of(i));
+			CHECK_EQUAL(0, sNumLive);
+
+			pool.exit();
+			CHECK_EQUAL(0, pool.capacity());
+
+			// Re-initialize, the pool starts empty and the destructor releases the storage
+			pool.init(gSystemAllocator, 10);
+			CHECK_TRUE(pool.empty());
+			CHECK_EQUAL(0, pool.idx_of(pool.allocate()));
+			pool.deallocate(pool.ptr_of(0));
+        }
+	}
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,83 @@
+#include "xbase/x_target.h"
+#include "xbase/x_allocator.h"
+#include "xallocator/x_soadexed_array.h"
+
+#include "xunittest/xunittest.h"
+
+using namespace xcore;
+
+extern xcore::alloc_t* gSystemAllocator;
+
+UNITTEST_SUITE_BEGIN(x_soadexed_array)
+{
+	UNITTEST_FIXTURE(main)
+	{
+		UNITTEST_FIXTURE_SETUP()
+		{
+		}
+
+		UNITTEST_FIXTURE_TEARDOWN()
+		{
+		}
+
+		UNITTEST_TEST(columns)
+		{
+			u32 const   fields[] = { sizeof(f32), sizeof(f32), 1, 48 };
+			soadexed_t* soa      = gCreateSoaIdxAllocator(gSystemAllocator, gSystemAllocator, fields, 4, 200);
+			CHECK_EQUAL(4, soa->num_columns());
+			CHECK_EQUAL(200, soa->capacity());
+
+			for (u32 c = 0; c < soa->num_columns(); ++c)
+			{
+				CHECK_EQUAL(0, (uptr)soa->column(c) & (soadexed_t::COLUMN_ALIGNMENT - 1));
+				CHECK_EQUAL(fields[c], soa->field_size(c));
+			}
+
+			for (u32 i = 0; i < 200; ++i)
+			{
+				u32 idx = soa->iallocate();
+				CHECK_EQUAL(i, idx);
+				soa->column_as<f32>(0)[idx] = (f32)idx;
+				soa->column_as<f32>(1)[idx] = 2.0f;
+			}
+			CHECK_EQUAL(0xffffffff, soa->iallocate());
+			CHECK_EQUAL(200, soa->live_end());
+
+			for (u32 i = 100; i < 200; ++i)
+				soa->ideallocate(i);
+			CHECK_EQUAL(100, soa->live_end());
+			soa->ideallocate(10);
+			CHECK_EQUAL(100, soa->live_end());
+			CHECK_EQUAL(99, soa->occupancy().count());
+
+			// Reuses the hole first
+			CHECK_EQUAL(10, soa->iallocate());
+
+			f32 sum = 0.0f;
+			f32 const* x = soa->column_as<f32>(0);
+			f32 const* y = soa->column_as<f32>(1);
+			soa->occupancy().for_each_live([&](u32 i) { sum += x[i] * y[i]; }, 0, soa->live_end());
+			CHECK_EQUAL(2.0f * (99.0f * 100.0f / 2.0f), sum);
+
+			// fsadexed_t interface works on column 0
+			void* p = soa->idx2ptr(50);
+			CHECK_EQUAL(soa->field(50, 0), p);
+			CHECK_EQUAL(50, soa->ptr2idx(p));
+
+			for (u32 i = 0; i < 100; ++i)
+				soa->ideallocate(i);
+			CHECK_EQUAL(0, soa->live_end());
+
+			soa->release();
+		}
+
+		UNITTEST_TEST(too_large)
+		{
+			// 64 KB x 64 KB + 1 elements would wrap around in 32 bits
+			u32 const fields[] = { 0x10000, 4 };
+			CHECK_NULL(gCreateSoaIdxAllocator(gSystemAllocator, gSystemAllocator, fields, 1, 0x10001));
+			CHECK_NULL(gCreateSoaIdxAllocator(gSystemAllocator, gSystemAllocator, fields, 2, 0xffff));
+		}
+	}
+}
+UNITTEST_SUITE_END
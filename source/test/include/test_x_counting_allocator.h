@@ -0,0 +1,28 @@
+#ifndef __X_ALLOCATOR_TEST_COUNTING_ALLOCATOR_H__
+#define __X_ALLOCATOR_TEST_COUNTING_ALLOCATOR_H__
+#include "xbase/x_target.h"
+#ifdef USE_PRAGMA_ONCE
+#pragma once
+#endif
+
+#include "xbase/x_allocator.h"
+
+namespace xcore
+{
+	// Parent allocator for the tests, counts the allocations that are live in @allocator
+	class xcounting_allocator : public alloc_t
+	{
+	public:
+		xcounting_allocator(alloc_t* allocator) : mAllocator(allocator), mNumAllocations(0) {}
+
+		alloc_t*		mAllocator;
+		s32				mNumAllocations;
+
+	protected:
+		virtual void*	v_allocate(u32 size, u32 alignment)		{ ++mNumAllocations; return mAllocator->allocate(size, alignment); }
+		virtual u32		v_deallocate(void* ptr)					{ --mNumAllocations; return mAllocator->deallocate(ptr); }
+		virtual void	v_release()								{ }
+	};
+}; // namespace xcore
+
+#endif /// __X_ALLOCATOR_TEST_COUNTING_ALLOCATOR_H__
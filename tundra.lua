@@ -58,8 +58,34 @@ Build {
 			Sources = { SourceGlob("source/test/cpp") },
 			Includes = { "source/main/include","source/test/include","../xunittest/source/main/include","../xentry/source/main/include","../xbase/source/main/include","source/main/include" },
 			Depends = { xbase_library,xallocator_library,xunittest_library,xentry_library },
+			Libs = { { "pthread"; Config = "linux-*-*-*" } },
+		}
+		local preload = SharedLibrary {
+			Name = "xallocator_preload",
+			Config = "linux-*-*-*",
+			Sources = { SourceGlob("source/preload/cpp") },
+			Includes = { "source/main/include","../xbase/source/main/include" },
+			Depends = { xbase_library,xallocator_library },
+			Libs = { "pthread" },
+		}
+		local preload_smoke = Program {
+			Name = "xallocator_preload_smoke",
+			Config = "linux-*-*-*",
+			Sources = { SourceGlob("source/preload/test/cpp") },
+			Libs = { "pthread" },
+		}
+		-- Benchmarks, not run by the unit tests
+		local bench = Program {
+			Name = "xallocator_bench",
+			Config = "*-*-*-*",
+			Sources = { SourceGlob("source/bench/cpp") },
+			Includes = { "source/main/include","../xbase/source/main/include" },
+			Depends = { xbase_library,xallocator_library },
 		}
 		Default(unittest)
+		Default(bench)
+		Default(preload)
+		Default(preload_smoke)
 	end,
 	Configs = {
 		Config {
@@ -90,6 +116,11 @@ Build {
 				OBJECTROOT = "target",
 			},
 			Name = "linux-gcc",
+			Env = {
+				-- The static libraries are linked into the preload library
+				CCOPTS = { "-fPIC" },
+				CXXOPTS = { "-fPIC" },
+			},
 			DefaultOnHost = "linux",
 			Tools = { "gcc" },
 		},